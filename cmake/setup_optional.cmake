@@ -117,3 +117,98 @@ if(KRIMS_HAVE_GLIBC_STACKTRACE)
 		KRIMS_HAVE_LIBSTDCXX_DEMANGLER)
 endif()
 
+
+#####################
+#-- Memory mapping --#
+#####################
+#
+# Check whether files can be mapped into memory via the POSIX interface,
+# which is used for loading GenMap snapshots without copying.
+#
+CHECK_CXX_SOURCE_COMPILES(
+	"
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	int main() {
+		int fd = open(\"file\", O_RDONLY);
+		struct stat st;
+		fstat(fd, &st);
+		void* ptr = mmap(nullptr, static_cast<size_t>(st.st_size),
+		                 PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		return munmap(ptr, static_cast<size_t>(st.st_size));
+	}
+	"
+	KRIMS_HAVE_POSIX_MMAP)
+
+#
+# Check whether POSIX shared memory objects are available, which are used
+# for sharing GenMap snapshots between processes. Older versions of glibc
+# provide shm_open in librt.
+#
+if(KRIMS_HAVE_POSIX_MMAP)
+	set(KRIMS_POSIX_SHM_TEST_SOURCE
+		"
+		#include <fcntl.h>
+		#include <sys/mman.h>
+		int main() {
+			int fd = shm_open(\"/krims\", O_RDONLY, 0);
+			return fd < 0 ? shm_unlink(\"/krims\") : 0;
+		}
+		")
+	CHECK_CXX_SOURCE_COMPILES("${KRIMS_POSIX_SHM_TEST_SOURCE}" KRIMS_HAVE_POSIX_SHM)
+	if (NOT KRIMS_HAVE_POSIX_SHM)
+		set(CMAKE_REQUIRED_LIBRARIES rt)
+		CHECK_CXX_SOURCE_COMPILES("${KRIMS_POSIX_SHM_TEST_SOURCE}" KRIMS_HAVE_POSIX_SHM_LIBRT)
+		unset(CMAKE_REQUIRED_LIBRARIES)
+		if (KRIMS_HAVE_POSIX_SHM_LIBRT)
+			set(KRIMS_HAVE_POSIX_SHM ON)
+			set(KRIMS_DEPENDENCIES ${KRIMS_DEPENDENCIES} rt)
+		endif()
+	endif()
+	unset(KRIMS_POSIX_SHM_TEST_SOURCE)
+endif()
+
+#########################
+#-- Number conversion --#
+#########################
+#
+# Check whether std::from_chars is available for integers and floating point
+# numbers, which is used for parsing numbers in GenMap config files.
+# Also check for std::pmr memory resources.
+#
+if(KRIMS_HAVE_CXX17)
+	set(CMAKE_REQUIRED_FLAGS_ORIG "${CMAKE_REQUIRED_FLAGS}")
+	set(CMAKE_REQUIRED_FLAGS "${CMAKE_REQUIRED_FLAGS} -std=c++17")
+	CHECK_CXX_SOURCE_COMPILES(
+		"
+		#include <charconv>
+		int main() {
+			const char str[] = \"1.5\";
+			long l;
+			double d;
+			std::from_chars(str, str + 1, l);
+			return std::from_chars(str, str + 3, d).ec == std::errc() ? 0 : 1;
+		}
+		"
+		KRIMS_HAVE_FROM_CHARS)
+
+	# Check whether polymorphic memory resources are available, which
+	# are used to allocate the nodes of GenMaps from an arena.
+	CHECK_CXX_SOURCE_COMPILES(
+		"
+		#include <map>
+		#include <memory_resource>
+		int main() {
+			std::pmr::monotonic_buffer_resource arena;
+			std::pmr::map<int, int> map(&arena);
+			map[1] = 2;
+			return map.at(1) == 2 ? 0 : 1;
+		}
+		"
+		KRIMS_HAVE_MEMORY_RESOURCE)
+	set(CMAKE_REQUIRED_FLAGS "${CMAKE_REQUIRED_FLAGS_ORIG}")
+	unset(CMAKE_REQUIRED_FLAGS_ORIG)
+endif()
@@ -74,11 +74,15 @@ void print_map(const GenMap& map) {
   std::cout << "eins:             " << map.at<const std::string>("eins") << std::endl;
   std::cout << "a->data:          " << map.at<const A>("a").data << std::endl;
 
-#ifndef DEBUG
-  // Note that the types have to match. This will yield undefined behaviour
-  // in a Release build and an aborting of the Program in a Debug build.
-  std::cout << "always (rubbish): " << map.at<const int>("always") << std::endl;
-#endif
+  // Note that the types have to match. Otherwise an exception is thrown
+  // (in Debug as well as in Release builds)
+  try {
+    const int rubbish = map.at<const int>("always");
+    std::cout << "always (rubbish): " << rubbish << std::endl;
+  } catch (const GenMap::ExcWrongTypeRequested&) {
+    std::cout << "always is not an int, but a " << map.type_name_of("always")
+              << std::endl;
+  }
 
   std::cout << std::endl;
 }
@@ -86,9 +90,6 @@ void print_map(const GenMap& map) {
 void print_keys(const GenMap& map) {
   // Print all keys which are stored along
   // with a string describing the type of the data.
-  // Note: In RELEASE the type information is
-  // not stored for perfomance and space reasons
-  // and hence is not available!
   for (const auto& kv : map) {
     std::cout << std::setw(14) << kv.key() << "  " << kv.type_name() << std::endl;
   }
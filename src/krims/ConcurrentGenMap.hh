@@ -0,0 +1,170 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "GenMap.hh"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace krims {
+
+/** \brief A GenMap which can be read from many threads while it is updated.
+ *
+ * The map is organised as a sequence of immutable versions (snapshots).
+ * Writers obtain a copy of the current version, modify it and publish the
+ * result as the next version in one go. Readers always see a complete
+ * version, i.e. either all or none of the modifications made by one
+ * call to modify().
+ *
+ * Reading is done via a Reader object, which should be owned by a
+ * single thread. The Reader keeps the version it has last seen alive and only
+ * checks an atomic version counter on each access, such that readers
+ * never wait for writers or for each other:
+ * ```
+ * ConcurrentGenMap config{GenMap{{"tolerance", 1e-6}}};
+ *
+ * // In each worker thread:
+ * ConcurrentGenMap::Reader reader(config);
+ * double tol = reader.get().at<double>("tolerance");
+ *
+ * // In the thread which changes the configuration:
+ * config.modify([](GenMap& map) {
+ *   map.update("tolerance", 1e-8);
+ *   map.update("max_iter", 100);
+ * });
+ * ```
+ * A version of the map is freed once no Reader and no snapshot refers to it
+ * any more.
+ *
+ * \note Modifications of the data behind the entries (e.g. via a non-const
+ * ``at``) are not possible via the published versions, since these are const
+ * maps. Such data is shared between versions and would need to be protected
+ * by the user. Likewise watch() and flush() are non-const, so watches cannot
+ * be subscribed to published versions. For historic reasons
+ * ``insert_default`` is const nevertheless.
+ * It must never be called on a published version (e.g. the map returned by
+ * Reader::get()), since this would modify a map read by other threads.
+ * Insert defaults inside modify() instead.
+ */
+class ConcurrentGenMap {
+ public:
+  /** A per-thread handle for lock-free reading of the most recent version. */
+  class Reader {
+   public:
+    explicit Reader(const ConcurrentGenMap& map)
+          : m_map_ptr{&map}, m_version{0}, m_snapshot_ptr{nullptr} {}
+
+    /** Return the most recent published version of the map.
+     *
+     * The reference stays valid until the next call to get() on this object
+     * or the destruction of the Reader.
+     */
+    const GenMap& get() {
+      const size_t version = m_map_ptr->version();
+      if (version != m_version || m_snapshot_ptr == nullptr) {
+        // A new version has been published, so reload the snapshot.
+        m_snapshot_ptr = m_map_ptr->snapshot();
+        m_version      = version;
+      }
+      return *m_snapshot_ptr;
+    }
+
+   private:
+    //! The map to read from
+    const ConcurrentGenMap* m_map_ptr;
+
+    //! The version of the snapshot we hold.
+    size_t m_version;
+
+    //! The snapshot of the most recent version we have seen.
+    std::shared_ptr<const GenMap> m_snapshot_ptr;
+  };
+
+  /** \brief Construct from an initial map, which becomes the first version.
+   *
+   * The map is taken over by a fork (see GenMap::fork), which shares the
+   * entries with ``initial`` until either of them is modified.
+   */
+  explicit ConcurrentGenMap(const GenMap& initial = GenMap{})
+        : m_current_ptr{std::make_shared<const GenMap>(initial.fork())},
+          m_version{1},
+          m_write_mutex{} {}
+
+  /** Return a pointer to the most recent version of the map.
+   *
+   * \note This involves an atomic load of a shared pointer, which may be
+   *       implemented using a lock. For repeated reads use a Reader.
+   */
+  std::shared_ptr<const GenMap> snapshot() const {
+    return std::atomic_load(&m_current_ptr);
+  }
+
+  /** Return the number of the most recent version, which increases
+   *  by one with each published modification. */
+  size_t version() const { return m_version.load(std::memory_order_acquire); }
+
+  /** \brief Modify the map and publish the result as a new version.
+   *
+   * The functor is called with a fork of the current version, which it may
+   * modify arbitrarily. The first modification copies the entries of the
+   * current version (see GenMap::fork), such that each call to modify costs
+   * at least one copy of the map. Afterwards the copy is published,
+   * such that all modifications become visible at once.
+   * Concurrent calls to modify are executed one after another.
+   *
+   * If the functor throws, no new version is published.
+   */
+  template <typename Modifier>
+  void modify(Modifier&& modifier) {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    GenMap next = snapshot()->fork();
+    modifier(next);
+    publish(std::move(next));
+  }
+
+  /** \brief Insert or update a single key, publishing a new version
+   *
+   * To update many keys use modify().
+   */
+  void update(const std::string& key, GenMap::entry_value_type e) {
+    modify([&key, &e](GenMap& map) { map.update(key, std::move(e)); });
+  }
+
+ private:
+  /** Publish a new version (write mutex needs to be held) */
+  void publish(GenMap next) {
+    auto next_ptr = std::make_shared<GenMap>(std::move(next));
+    std::atomic_store(&m_current_ptr, std::shared_ptr<const GenMap>(std::move(next_ptr)));
+    // Increase version only afterwards, such that Readers seeing the
+    // new version number are guaranteed to obtain the new snapshot.
+    m_version.fetch_add(1, std::memory_order_release);
+  }
+
+  //! The most recent version (only accessed via atomic_load and atomic_store)
+  std::shared_ptr<const GenMap> m_current_ptr;
+
+  //! The number of the most recent version
+  std::atomic<size_t> m_version;
+
+  //! Mutex serialising the writers.
+  std::mutex m_write_mutex;
+};
+
+}  // namespace krims
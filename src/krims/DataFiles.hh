@@ -19,5 +19,6 @@
 
 #pragma once
 #include "DataFiles/FindDataFile.hh"
+#include "DataFiles/MappedFile.hh"
 #include "DataFiles/read_binary.hh"
 #include "DataFiles/write_binary.hh"
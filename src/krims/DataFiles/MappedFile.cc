@@ -0,0 +1,87 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "MappedFile.hh"
+#include "krims/ExceptionSystem.hh"
+#include "krims/config.hh"
+#include <fstream>
+
+#ifdef KRIMS_HAVE_POSIX_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace krims {
+
+MappedFile::MappedFile(const std::string& file) : MappedFile{} {
+#ifdef KRIMS_HAVE_POSIX_MMAP
+  const int fd = open(file.c_str(), O_RDONLY);
+  assert_throw(fd >= 0, ExcFileNotOpen(file.c_str()));
+  map_descriptor(fd);
+#else
+  std::ifstream in(file, std::ios::binary);
+  assert_throw(in, ExcFileNotOpen(file.c_str()));
+  in.seekg(0, std::ios::end);
+  m_size = static_cast<size_t>(in.tellg());
+  in.seekg(0, std::ios::beg);
+  if (m_size == 0) return;
+
+  m_data_ptr.reset(new char[m_size], std::default_delete<char[]>());
+  in.read(m_data_ptr.get(), static_cast<std::streamsize>(m_size));
+  assert_throw(in, ExcIO());
+#endif
+}
+
+#ifdef KRIMS_HAVE_POSIX_SHM
+MappedFile MappedFile::shared_memory(const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  assert_throw(fd >= 0, ExcFileNotOpen(name.c_str()));
+  MappedFile res;
+  res.map_descriptor(fd);
+  return res;
+}
+#endif
+
+#ifdef KRIMS_HAVE_POSIX_MMAP
+void MappedFile::map_descriptor(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    assert_throw(false, ExcIO());
+  }
+  m_size = static_cast<size_t>(st.st_size);
+  if (m_size == 0) {
+    // Empty files cannot be mapped
+    close(fd);
+    return;
+  }
+
+  // A private mapping, such that modifications are never written to the file.
+  void* ptr = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping stays valid
+  assert_throw(ptr != MAP_FAILED, ExcIO());
+
+  const size_t size = m_size;
+  m_data_ptr.reset(static_cast<char*>(ptr), [size](char* p) { munmap(p, size); });
+}
+#endif
+
+}  // namespace krims
@@ -0,0 +1,81 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "krims/config.hh"
+#include <memory>
+#include <string>
+
+namespace krims {
+
+/** \brief A file which has been loaded into memory as a whole.
+ *
+ * If supported by the system (KRIMS_HAVE_POSIX_MMAP) the file is not
+ * read, but mapped privately into memory, such that only the pages which
+ * are accessed are loaded from disk. The memory may be modified, but the
+ * modifications are never written back to the file. Otherwise the file
+ * is read into a buffer allocated with new[].
+ *
+ * In either case the memory is suitably aligned for all scalar types.
+ * Copies of the object share the memory, which is released once the last
+ * copy (and the last shared pointer obtained from data_ptr()) is destroyed.
+ */
+class MappedFile {
+ public:
+  /** Load a file into memory. Throws ExcFileNotOpen if the file
+   *  cannot be opened and ExcIO if it cannot be loaded. */
+  explicit MappedFile(const std::string& file);
+
+#ifdef KRIMS_HAVE_POSIX_SHM
+  /** Load the POSIX shared memory object ``name`` (see ``shm_open``) into memory.
+   *
+   * The object is mapped privately as well, such that processes sharing
+   * the object share the physical memory of all pages they do not modify.
+   * Throws ExcFileNotOpen if the object cannot be opened and ExcIO if it
+   * cannot be mapped.
+   */
+  static MappedFile shared_memory(const std::string& name);
+#endif
+
+  /** Return a pointer to the first byte of the file (nullptr if it is empty) */
+  char* data() const { return m_data_ptr.get(); }
+
+  /** Return the size of the file in bytes */
+  size_t size() const { return m_size; }
+
+  /** Return the shared pointer managing the memory.
+   *
+   * Use it with the aliasing constructor of std::shared_ptr to obtain
+   * pointers into the file which keep the memory alive.
+   */
+  const std::shared_ptr<char>& data_ptr() const { return m_data_ptr; }
+
+ private:
+  MappedFile() : m_data_ptr{nullptr}, m_size{0} {}
+
+#ifdef KRIMS_HAVE_POSIX_MMAP
+  /** Map the file referred to by the descriptor fd, which is closed afterwards */
+  void map_descriptor(int fd);
+#endif
+
+  std::shared_ptr<char> m_data_ptr;
+  size_t m_size;
+};
+
+}  // namespace krims
@@ -0,0 +1,178 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "FrozenGenMap.hh"
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+
+namespace krims {
+
+namespace {
+/** Compare the full keys of the entries with full keys */
+struct EntryKeyLess {
+  typedef typename FrozenGenMap::container_type::value_type entry_type;
+
+  bool operator()(const entry_type& entry, const std::string& key) const {
+    return detail::GenMapKeyLess{}(entry.first, key);
+  }
+};
+
+/** Continue the (FNV-1a) hash ``hash`` with the characters [data, data + n) */
+inline uint64_t hash_chars(uint64_t hash, const char* data, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+//! The initial value of the FNV-1a hash
+const uint64_t hash_offset = 14695981039346656037ull;
+
+/** Hash of a full key */
+inline uint64_t hash_key(const std::string& key) {
+  return hash_chars(hash_offset, key.data(), key.size());
+}
+
+/** Hash of a split key, which equals the hash of the represented full key */
+inline uint64_t hash_key(const detail::GenMapSplitKey& key) {
+  uint64_t hash = hash_chars(hash_offset, key.location, key.location_size);
+  if (key.path_size == 0) return hash;
+  hash = hash_chars(hash, "/", 1);
+  return hash_chars(hash, key.path, key.path_size);
+}
+}  // namespace
+
+FrozenGenMap GenMap::freeze() const {
+  const map_type& map = container();
+  const auto first    = starting_keys_begin(map, m_location);
+  const auto last     = starting_keys_end(map, m_location);
+
+  // Copy the entries in the order of the map, which is the order
+  // needed for the binary search. The location of this map is stripped off,
+  // such that the frozen map has its root at our location.
+  FrozenGenMap::container_type entries;
+  entries.reserve(static_cast<size_t>(std::distance(first, last)));
+  for (auto it = first; it != last; ++it) {
+    entries.emplace_back(it->first.substr(m_location.size()), it->second);
+  }
+  return FrozenGenMap{std::move(entries)};
+}
+
+FrozenGenMap::FrozenGenMap(container_type entries)
+      : m_storage_ptr{nullptr}, m_location{""}, m_first{0}, m_last{entries.size()} {
+  auto storage_ptr     = std::make_shared<Storage>();
+  storage_ptr->entries = std::move(entries);
+
+  // Build the hash table of the entry indices
+  size_t n_slots = 2;
+  while (n_slots < 2 * m_last) n_slots *= 2;
+  std::vector<size_t>& index = storage_ptr->hash_index;
+  index.assign(n_slots, 0);
+  for (size_t i = 0; i < m_last; ++i) {
+    size_t slot = hash_key(storage_ptr->entries[i].first) & (n_slots - 1);
+    while (index[slot] != 0) slot = (slot + 1) & (n_slots - 1);
+    index[slot] = i + 1;
+  }
+
+  m_storage_ptr = std::move(storage_ptr);
+}
+
+FrozenGenMap::FrozenGenMap(const FrozenGenMap& other, const std::string& location)
+      : m_storage_ptr{other.m_storage_ptr},
+        m_location{other.make_full_key(location)},
+        m_first{0},
+        m_last{0} {
+  std::tie(m_first, m_last) = other.subtree_range(m_location);
+}
+
+FrozenGenMap FrozenGenMap::submap(const std::string& location) const {
+  return FrozenGenMap{*this, location};
+}
+
+std::string FrozenGenMap::make_full_key(const key_view_type& key) const {
+  std::string res{m_location};
+  GenMapKey::append_normalised(res, key);
+  return res;
+}
+
+template <typename Key>
+typename FrozenGenMap::entry_iterator FrozenGenMap::find_hashed(const Key& key) const {
+  const std::vector<size_t>& index = m_storage_ptr->hash_index;
+  const size_t mask                = index.size() - 1;
+
+  // Since all full keys starting with the location are part of the subtree
+  // of this map, no check whether the entry is in our range is needed.
+  for (size_t slot = hash_key(key) & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+    const auto pos = static_cast<ptrdiff_t>(index[slot] - 1);
+    const auto it  = m_storage_ptr->entries.begin() + pos;
+    if (detail::GenMapKeyLess::compare(it->first, key) == 0) {
+      assert_internal(begin_entries() <= it && it < end_entries());
+      return it;
+    }
+  }
+  return end_entries();
+}
+
+typename FrozenGenMap::entry_iterator FrozenGenMap::find_entry(
+      const key_view_type& key) const {
+  if (GenMapKey::is_normalised(key)) {
+    // Search for the concatenation of location and key without building it.
+    const size_t skip = (key.size() > 0 && key[0] == '/') ? 1 : 0;
+    const detail::GenMapSplitKey split_key{m_location.data(), m_location.size(),
+                                           key.data() + skip, key.size() - skip};
+    return find_hashed(split_key);
+  }
+  return find_hashed(make_full_key(key));
+}
+
+std::pair<size_t, size_t> FrozenGenMap::subtree_range(const std::string& start) const {
+  // As in the GenMap all keys of the subtree are ordered directly after start
+  // and before start + '\0', see detail::GenMapKeyLess.
+  const entry_iterator first = begin_entries();
+  const entry_iterator last  = end_entries();
+  auto it_first              = std::lower_bound(first, last, start, EntryKeyLess{});
+  auto it_last               = last;
+  if (start.length() > 0) {
+    std::string bound{start};
+    bound.push_back('\0');
+    it_last = std::lower_bound(it_first, last, bound, EntryKeyLess{});
+  }
+
+  const entry_iterator all_begin = m_storage_ptr->entries.begin();
+  return {static_cast<size_t>(it_first - all_begin),
+          static_cast<size_t>(it_last - all_begin)};
+}
+
+typename FrozenGenMap::const_iterator FrozenGenMap::cbegin(
+      const std::string& path) const {
+  const std::string path_full = make_full_key(path);
+  const auto first            = static_cast<ptrdiff_t>(subtree_range(path_full).first);
+  return const_iterator(m_storage_ptr->entries.begin() + first, path_full);
+}
+
+typename FrozenGenMap::const_iterator FrozenGenMap::cend(
+      const std::string& path) const {
+  const std::string path_full = make_full_key(path);
+  const auto last             = static_cast<ptrdiff_t>(subtree_range(path_full).second);
+  return const_iterator(m_storage_ptr->entries.begin() + last, path_full);
+}
+
+}  // namespace krims
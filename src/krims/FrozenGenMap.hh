@@ -0,0 +1,239 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "GenMap.hh"
+#include <vector>
+
+namespace krims {
+
+/** \brief An immutable, read-optimised copy of a GenMap.
+ *
+ * Obtained from GenMap::freeze(). All keys and entries are stored in a
+ * single contiguous array sorted in the same order as inside the GenMap.
+ * Additionally a hash table of the positions in this array is built once,
+ * such that a lookup is a hash computation and (typically) a single key
+ * comparison instead of a walk through the nodes of a tree. Keys which
+ * are already normalised are looked up without any memory allocation.
+ *
+ * The entries may not be added, removed or replaced, but the interface
+ * for reading (``at``, ``at_ptr``, ``exists``, ``submap`` and the iterators)
+ * is the same as the one of the const GenMap. Like a copy of a GenMap the
+ * FrozenGenMap only copies the pointers to the data and not the data itself
+ * (see the documentation of the GenMap copy constructor).
+ *
+ * Copies and submaps of a FrozenGenMap share the entry array and are
+ * constant-time operations.
+ * ```
+ * GenMap params{{"tolerance", 1e-6}, {"solver/max_iter", 100}};
+ * const FrozenGenMap frozen = params.freeze();
+ * double tol = frozen.at<double>("tolerance");
+ * int max_iter = frozen.submap("solver").at<int>("max_iter");
+ * ```
+ */
+class FrozenGenMap {
+ public:
+  typedef typename detail::GenMapTraits::entry_value_type entry_value_type;
+  typedef typename detail::GenMapTraits::key_view_type key_view_type;
+
+  //! The type of the array storing the full keys and the entries
+  typedef std::vector<std::pair<std::string, entry_value_type>> container_type;
+  typedef GenMapIterator<true, typename container_type::const_iterator> const_iterator;
+  typedef const_iterator iterator;
+
+  typedef typename GenMap::ExcUnknownKey ExcUnknownKey;
+  typedef typename GenMap::ExcWrongTypeRequested ExcWrongTypeRequested;
+
+  /** \brief Construct an empty frozen map */
+  FrozenGenMap() : FrozenGenMap{container_type{}} {}
+
+  /** \name Obtaining elements and pointers to elements */
+  ///@{
+  /** Return a reference to the value at a given key
+   *  with the specified type.
+   *
+   * If the value cannot be found an ExcUnknownKey is thrown.
+   * If the type requested is wrong an ExcWrongTypeRequested is thrown.
+   */
+  template <typename T>
+  const T& at(const key_view_type& key) const {
+    return at_raw_value(key).get<T>();
+  }
+
+  /** \brief Get the value of an element.
+   *
+   * If the key cannot be found, returns the provided reference instead.
+   * If the type requested is wrong an ExcWrongTypeRequested is thrown.
+   */
+  template <typename T>
+  const T& at(const key_view_type& key, const T& default_value) const {
+    auto itkey = find_entry(key);
+    return itkey == end_entries() ? default_value : itkey->second.get<T>();
+  }
+
+  /** Return a pointer to the value of a specific key.
+   *
+   * See GenMap::at_ptr for details.
+   */
+  template <typename T>
+  RCPWrapper<const T> at_ptr(const key_view_type& key) const {
+    return at_raw_value(key).get_ptr<T>();
+  }
+
+  //@{
+  /** \brief Get the pointer to the value of a key or a default.
+   *
+   * If the key cannot be found, returns the provided pointer instead.
+   * If the type requested is wrong an ExcWrongTypeRequested is thrown.
+   */
+  template <typename T>
+  RCPWrapper<const T> at_ptr(const key_view_type& key,
+                             RCPWrapper<const T> default_ptr) const {
+    auto itkey = find_entry(key);
+    return itkey == end_entries() ? default_ptr : itkey->second.get_ptr<T>();
+  }
+
+  template <typename T>
+  RCPWrapper<const T> at_ptr(const key_view_type& key,
+                             std::shared_ptr<const T> default_ptr) const {
+    return at_ptr(key, RCPWrapper<const T>(default_ptr));
+  }
+  //@}
+
+  /** Return an GenMapValue object representing the data behind the specified key
+   *
+   * \note This is an advanced method. Use only if you know what you are doing.
+   * */
+  const detail::GenMapValue& at_raw_value(const key_view_type& key) const {
+    auto itkey = find_entry(key);
+    assert_throw(itkey != end_entries(), ExcUnknownKey(std::string(key)));
+    return itkey->second;
+  }
+  ///@}
+
+  /** Check weather a key exists */
+  bool exists(const key_view_type& key) const { return find_entry(key) != end_entries(); }
+
+  /** Return a string which describes the type of the
+   * stored data
+   *
+   * \note The type name is only demangled if the OS exposes an interface
+   * for type demangling.
+   */
+  std::string type_name_of(const key_view_type& key) const {
+    return at_raw_value(key).type_name();
+  }
+
+  /** Has the value of an entry already been computed (see GenMap::is_evaluated) */
+  bool is_evaluated(const key_view_type& key) const {
+    return at_raw_value(key).evaluated();
+  }
+
+  /** Return the number of entries in the map */
+  size_t size() const { return m_last - m_first; }
+
+  /** Is the map empty */
+  bool empty() const { return m_first == m_last; }
+
+  /** \brief Get a submap starting at a different location.
+   *
+   * The submap is a view into the subtree of *this and shares the entry
+   * array with it. See GenMap::submap for details on the paths.
+   */
+  FrozenGenMap submap(const std::string& location) const;
+
+  /** \name Iterators */
+  ///@{
+  /** Return an iterator to the beginning of the map or the beginning of a
+   * specified subpath.
+   *
+   * \note Equivalent to ``submap(path).begin()``. See GenMap::begin for details.
+   */
+  const_iterator begin(const std::string& path = "/") const { return cbegin(path); }
+  const_iterator cbegin(const std::string& path = "/") const;
+
+  /** Returns the matching end iterator to begin() or cbegin(). */
+  const_iterator end(const std::string& path = "/") const { return cend(path); }
+  const_iterator cend(const std::string& path = "/") const;
+  ///@}
+
+ private:
+  friend class GenMap;
+
+  /** Construct from the sorted array of entries (with full keys) */
+  explicit FrozenGenMap(container_type entries);
+
+  /** Construct a view into the subtree of another frozen map at a
+   *  given location (relative to the location of ``other``) */
+  FrozenGenMap(const FrozenGenMap& other, const std::string& location);
+
+  typedef typename container_type::const_iterator entry_iterator;
+
+  /** The data shared between a FrozenGenMap, its copies and its submaps */
+  struct Storage {
+    //! The entries sorted by their full keys
+    container_type entries;
+
+    /** Hash table (open addressing, linear probing) with the index of the
+     *  entry plus one for each full key (0 marks an empty slot). The size is
+     *  a power of two and at least twice the number of entries. */
+    std::vector<size_t> hash_index;
+  };
+
+  /** Make the actual key inside the array from a key supplied by the user */
+  std::string make_full_key(const key_view_type& key) const;
+
+  /** Find the entry corresponding to a key (or end_entries()) */
+  entry_iterator find_entry(const key_view_type& key) const;
+
+  /** Find the entry corresponding to a full key or split key
+   *  using the hash table (or return end_entries()) */
+  template <typename Key>
+  entry_iterator find_hashed(const Key& key) const;
+
+  //@{
+  /** The range of entries which are part of this (sub)map */
+  entry_iterator begin_entries() const {
+    return m_storage_ptr->entries.begin() + static_cast<ptrdiff_t>(m_first);
+  }
+  entry_iterator end_entries() const {
+    return m_storage_ptr->entries.begin() + static_cast<ptrdiff_t>(m_last);
+  }
+  //@}
+
+  /** Return the indices of the range of entries, which are equal to the
+   *  full key ``start`` or are located in the subtree below it. */
+  std::pair<size_t, size_t> subtree_range(const std::string& start) const;
+
+  //! The storage shared between all copies and submaps
+  std::shared_ptr<const Storage> m_storage_ptr;
+
+  /** The location we are currently on in the tree
+   * (like GenMap::m_location) */
+  std::string m_location;
+
+  //@{
+  /** The first and past-the-end index of the entries belonging to
+   *  the subtree at m_location */
+  size_t m_first;
+  size_t m_last;
+  //@}
+};
+
+}  // namespace krims
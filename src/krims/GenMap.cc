@@ -18,36 +18,261 @@
 //
 
 #include "GenMap.hh"
+#include "GenMapStatistics.hh"
+#include "detail/Hash128.hh"
+#include <algorithm>
 #include <vector>
 
 namespace krims {
 
+namespace {
+/** Return the first entry of the map, which is not less than key.
+ *
+ * The search starts at pos, which may not be past the entry searched for.
+ * If the entry is only a few steps away from pos (which is the common case
+ * when inserting many sorted keys) it is found by walking the map linearly,
+ * otherwise a search from the root of the map is done.
+ */
+template <typename Map>
+typename Map::iterator seek_entry(Map& map, typename Map::iterator pos,
+                                  const std::string& key) {
+  const size_t max_steps = 8;
+  const auto comp        = map.key_comp();
+  for (size_t step = 0; pos != std::end(map) && comp(pos->first, key); ++pos, ++step) {
+    if (step == max_steps) return map.lower_bound(key);
+  }
+  return pos;
+}
+
+/** Is pos an iterator to the entry with the given key (where pos is the
+ *  first entry not less than key). */
+template <typename Map>
+bool is_entry(const Map& map, typename Map::iterator pos, const std::string& key) {
+  return pos != std::end(map) && !map.key_comp()(key, pos->first);
+}
+
+/** Is the full key located in the subtree below the full key path */
+bool is_below(const std::string& key, const std::string& path) {
+  return key.size() > path.size() && key[path.size()] == '/' &&
+         key.compare(0, path.size(), path) == 0;
+}
+
+/** Collect the changed keys affecting the subtree below the full key ``path``
+ *  from the set of changed full keys ``changes``.
+ *
+ * The keys are returned relative to ``path``, where the empty key represents
+ * a change of ``path`` itself or of one of the subtrees containing it.
+ */
+std::vector<std::string> changes_affecting(
+      const detail::GenMapStorage::key_set_type& changes, const std::string& path) {
+  std::vector<std::string> res;
+
+  // Changes of path itself or its parents down to the root ""
+  bool whole_subtree = changes.count(path) > 0;
+  for (size_t pos = path.rfind('/'); !whole_subtree && pos != std::string::npos;
+       pos        = pos == 0 ? std::string::npos : path.rfind('/', pos - 1)) {
+    whole_subtree = changes.count(path.substr(0, pos)) > 0;
+  }
+  if (whole_subtree) res.emplace_back();
+
+  // Changes inside the subtree, i.e. in the range (path, path + '\0')
+  std::string bound{path};
+  bound.push_back('\0');
+  const auto end = changes.lower_bound(bound);
+  for (auto it = changes.upper_bound(path); it != end; ++it) {
+    res.push_back(it->substr(path.size() + 1));
+  }
+  return res;
+}
+
+/** Compute the fingerprint of the subtree below the full key ``path``,
+ *  which consists of the entries in the range [first, last).
+ *
+ * The fingerprint is the hash of the entry at path itself (if any) and the
+ * names and fingerprints of all direct children. The fingerprints of children
+ * with more than one entry are taken from the cache or computed and added to it.
+ */
+GenMapFingerprint subtree_fingerprint(
+      const detail::GenMapTraits::map_type& map, const std::string& path,
+      detail::GenMapTraits::map_type::const_iterator first,
+      detail::GenMapTraits::map_type::const_iterator last,
+      detail::GenMapStorage::fingerprint_map_type& cache) {
+  detail::Hash128 hash;
+  auto it = first;
+  if (it != last && it->first.size() == path.size()) {
+    hash.add_size(1);
+    it->second.add_to_hash(hash);
+    ++it;
+  } else {
+    hash.add_size(0);
+  }
+
+  std::string child;
+  while (it != last) {
+    // The key is path + "/" + name of the child [+ "/" + further path parts]
+    const size_t name_begin = path.size() + 1;
+    const size_t name_end   = std::min(it->first.find('/', name_begin), it->first.size());
+    child.assign(it->first, 0, name_end);
+    hash.add_string(child.data() + name_begin, name_end - name_begin);
+
+    GenMapFingerprint child_fingerprint;
+    auto next            = std::next(it);
+    const bool has_entry = child.size() == it->first.size();
+    if (has_entry && (next == last || !is_below(next->first, child))) {
+      // Single entry, which is not worth caching
+      child_fingerprint = subtree_fingerprint(map, child, it, next, cache);
+    } else {
+      std::string bound{child};
+      bound.push_back('\0');
+      next = map.lower_bound(bound);
+
+      auto itcache = cache.find(child);
+      if (itcache == std::end(cache)) {
+        const GenMapFingerprint res = subtree_fingerprint(map, child, it, next, cache);
+        itcache                     = cache.emplace(child, res).first;
+      }
+      child_fingerprint = itcache->second;
+    }
+    hash.add(&child_fingerprint.low, sizeof(uint64_t));
+    hash.add(&child_fingerprint.high, sizeof(uint64_t));
+    it = next;
+  }
+
+  const detail::Hash128Value res = hash.finish();
+  return GenMapFingerprint{res.low, res.high};
+}
+}  // namespace
+
 GenMap& GenMap::operator=(GenMap other) {
-  m_location      = std::move(other.m_location);
-  m_container_ptr = std::move(other.m_container_ptr);
+  m_location    = std::move(other.m_location);
+  m_storage_ptr = std::move(other.m_storage_ptr);
   return *this;
 }
 
 GenMap::GenMap(const GenMap& other) : GenMap() {
   if (other.m_location == std::string("")) {
     // We are root, copy everything
-    m_container_ptr = std::make_shared<map_type>(*other.m_container_ptr);
+    m_storage_ptr = std::make_shared<detail::GenMapStorage>(other.container());
   } else {
     update(other);
   }
 }
 
+GenMap GenMap::fork() const {
+  GenMap res;
+  res.m_storage_ptr =
+        std::make_shared<detail::GenMapStorage>(m_storage_ptr->map_ptr, m_location);
+  res.m_location = m_location;
+  return res;
+}
+
+GenMapFingerprint GenMap::fingerprint(const std::string& path) const {
+  const std::string path_full    = make_full_key(path);
+  detail::GenMapStorage& storage = *m_storage_ptr;
+  std::lock_guard<std::mutex> lock(storage.fingerprints_mutex);
+
+  auto itcache = storage.fingerprints.find(path_full);
+  if (itcache == std::end(storage.fingerprints)) {
+    const map_type& map = container();
+    const GenMapFingerprint res =
+          subtree_fingerprint(map, path_full, starting_keys_begin(map, path_full),
+                              starting_keys_end(map, path_full), storage.fingerprints);
+    itcache = storage.fingerprints.emplace(path_full, res).first;
+  }
+  return itcache->second;
+}
+
+GenMapWatch GenMap::watch(const std::string& path,
+                          GenMapWatch::callback_type callback) {
+  auto state_ptr = std::make_shared<GenMapWatch::State>(
+        GenMapWatch::State{make_full_key(path), std::move(callback), false});
+  m_storage_ptr->watches.push_back(state_ptr);
+  return GenMapWatch(std::move(state_ptr));
+}
+
+void GenMap::flush() {
+  detail::GenMapStorage& storage = *m_storage_ptr;
+
+  // Take the changes and watches out first, such that callbacks may modify
+  // the map or subscribe new watches.
+  detail::GenMapStorage::key_set_type changes;
+  std::swap(changes, storage.pending_changes);
+
+  std::vector<std::shared_ptr<GenMapWatch::State>> active;
+  auto expired = [&active](const std::weak_ptr<GenMapWatch::State>& ptr) {
+    auto state_ptr = ptr.lock();
+    if (state_ptr == nullptr) return true;
+    active.push_back(std::move(state_ptr));
+    return false;
+  };
+  storage.watches.erase(
+        std::remove_if(std::begin(storage.watches), std::end(storage.watches), expired),
+        std::end(storage.watches));
+  if (changes.empty()) return;
+
+  for (const auto& state_ptr : active) {
+    const std::vector<std::string> keys =
+          changes_affecting(changes, state_ptr->full_path);
+    if (keys.empty()) continue;
+    state_ptr->dirty = true;
+    if (state_ptr->callback) state_ptr->callback(keys);
+  }
+}
+
 void GenMap::update(std::initializer_list<entry_type> il) {
+  map_type& map = m_storage_ptr->map_for_writing();
+
   // Make each key a full path key and append/modify entry in map
-  for (entry_type t : il) {
-    (*m_container_ptr)[make_full_key(t.first)] = std::move(t.second);
+  for (const entry_type& t : il) {
+    std::string full_key = make_full_key(t.first);
+    m_storage_ptr->mark_modified(full_key);
+    auto pos = map.lower_bound(full_key);
+    if (is_entry(map, pos, full_key)) {
+      pos->second = t.second;
+    } else {
+      map.emplace_hint(pos, std::move(full_key), t.second);
+    }
+  }
+}
+
+void GenMap::insert_default(std::initializer_list<entry_type> il) const {
+  map_type& map = container();
+  for (const entry_type& t : il) {
+    // Key is normalised only once and the map only searched once.
+    std::string full_key = make_full_key(t.first);
+    auto pos             = map.lower_bound(full_key);
+    if (is_entry(map, pos, full_key)) continue;
+
+    m_storage_ptr->mark_modified(full_key);
+    if (m_storage_ptr->is_shared()) {
+      // Unshare the map, which invalidates pos
+      m_storage_ptr->map_for_writing().emplace(std::move(full_key), t.second);
+    } else {
+      map.emplace_hint(pos, std::move(full_key), t.second);
+    }
+  }
+}
+
+bool GenMap::insert_or_assign(const key_view_type& key, entry_value_type e) {
+  std::string full_key = make_full_key(key);
+  map_type& map        = m_storage_ptr->map_for_writing();
+  auto pos             = map.lower_bound(full_key);
+  const bool inserted  = !is_entry(map, pos, full_key);
+  if (inserted) {
+    pos = map.emplace_hint(pos, std::move(full_key), std::move(e));
+  } else {
+    pos->second = std::move(e);
   }
+  m_storage_ptr->mark_modified(pos->first);
+  return inserted;
 }
 
 void GenMap::clear() {
   if (m_location == std::string("")) {
     // We are root, clear everything
-    m_container_ptr->clear();
+    m_storage_ptr->mark_modified(m_location);
+    container_for_writing().clear();
+    m_storage_ptr->invalidate_iterators();
   } else {
     // Clear only our stuff
     erase(begin(), end());
@@ -55,67 +280,194 @@ void GenMap::clear() {
 }
 
 void GenMap::update(const std::string& key, const GenMap& other) {
-  for (auto it = other.begin(); it != other.end(); ++it) {
-    // The iterator truncates the other key relative to the builtin
-    // location of other for us. We then make it full for our location
-    // and update.
-    (*m_container_ptr)[make_full_key(key + "/" + it->key())] = it->value_raw();
+  map_type& map = m_storage_ptr->map_for_writing();
+  if (&other.container() == &map) {
+    // Updating from our own data: Make a copy first, such that
+    // the insertions do not disturb the iteration over other.
+    update(key, GenMap(other));
+    return;
+  }
+
+  // The keys of other are sorted and stay sorted if the location of other is
+  // replaced by the full key of our target location. So we can merge them
+  // into our map by walking along both ranges.
+  const std::string prefix = make_full_key(key);
+  const map_type& source   = other.container();
+  const size_t n_strip     = other.m_location.size();
+  const auto source_end    = starting_keys_end(source, other.m_location);
+  m_storage_ptr->mark_modified(prefix);
+
+  auto pos = map.lower_bound(prefix);
+  std::string full_key;
+  for (auto it = starting_keys_begin(source, other.m_location); it != source_end; ++it) {
+    full_key.assign(prefix).append(it->first, n_strip, std::string::npos);
+    pos = seek_entry(map, pos, full_key);
+    if (is_entry(map, pos, full_key)) {
+      pos->second = it->second;
+    } else {
+      pos = map.emplace_hint(pos, full_key, it->second);
+    }
   }
 }
 
 void GenMap::update(const std::string& key, GenMap&& other) {
-  for (auto it = other.begin(); it != other.end(); ++it) {
-    // The iterator truncates the other key relative to the builtin
-    // location of other for us. We then make it full for our location
-    // and update.
-    (*m_container_ptr)[make_full_key(key + "/" + it->key())] = std::move(it->value_raw());
+#ifdef KRIMS_HAVE_CXX17
+  // If nothing else refers to the data of other, move the map nodes over.
+  // This requires both maps to allocate their nodes in the same way.
+  const bool owns_data = other.m_location.empty() &&
+                         other.m_storage_ptr.use_count() == 1 &&
+                         !other.m_storage_ptr->is_shared() &&
+                         other.container().get_allocator() == container().get_allocator();
+  if (owns_data && &other.container() != &container()) {
+    const std::string prefix = make_full_key(key);
+    map_type& map            = m_storage_ptr->map_for_writing();
+    map_type& source         = other.container();
+    m_storage_ptr->mark_modified(prefix);
+
+    auto pos = map.lower_bound(prefix);
+    while (!source.empty()) {
+      auto node = source.extract(std::begin(source));
+      node.key().insert(0, prefix);
+      pos = seek_entry(map, pos, node.key());
+      if (is_entry(map, pos, node.key())) {
+        pos->second = std::move(node.mapped());
+      } else {
+        pos = map.insert(pos, std::move(node));
+      }
+    }
+    other.m_storage_ptr->invalidate_iterators();
+    other.m_storage_ptr->mark_modified(other.m_location);
+    return;
   }
+#endif
+
+  // Else copy the entries, which only copies the pointers to the data.
+  update(key, static_cast<const GenMap&>(other));
 }
 
-std::string GenMap::make_full_key(const std::string& key) const {
-  assert_internal(m_location[0] == '/' || m_location.length() == 0);
-  assert_internal(m_location.back() != '/');
+void GenMap::update(const GenMapKey& key, entry_value_type e) {
+  map_type& map = m_storage_ptr->map_for_writing();
+  auto itkey    = find_entry(key);
+  if (itkey != std::end(map)) {
+    m_storage_ptr->mark_modified(itkey->first);
+    itkey->second = std::move(e);
+  } else {
+    std::string full_key = m_location + key.path();
+    m_storage_ptr->mark_modified(full_key);
+    map[std::move(full_key)] = std::move(e);
+  }
+}
 
-  // Make a stack out of the key:
-  std::vector<std::string> pathparts;
+size_t GenMap::erase(const GenMapKey& key) {
+  map_type& map = m_storage_ptr->map_for_writing();
+  auto itkey    = find_entry(key);
+  if (itkey == std::end(map)) return 0;
 
-  // start gives the location after the last '/',
-  // ie where the current part of the key path begins and end gives
-  // the location of the current '/', i.e. the past-the-end index
-  // of the current path part.
-  for (size_t start = 0; start < key.size(); ++start) {
-    // Past-the-end of the current path part:
-    const size_t end = key.find('/', start);
+  m_storage_ptr->mark_modified(itkey->first);
+  map.erase(itkey);
+  m_storage_ptr->invalidate_iterators();
+  return 1;
+}
 
-    // Empty path part (i.e. something like '//' is encountered:
-    if (start == end) continue;
+void GenMap::unshare_container(std::initializer_list<map_type::iterator*> iters) const {
+  detail::GenMapStorage& storage = *m_storage_ptr;
+  if (!storage.is_shared()) return;
 
-    // Extract the part we deal with in this iteration:
-    std::string part = key.substr(start, end - start);
+  // Remember the keys the iterators point to (empty for the end iterator)
+  std::vector<std::pair<bool, std::string>> keys;
+  for (map_type::iterator* it : iters) {
+    const bool is_end = (*it == std::end(container()));
+    keys.emplace_back(is_end, is_end ? std::string() : (*it)->first);
+  }
 
-    // Update start for next iteration:
-    start += part.length();
+  storage.unshare();
 
-    if (part == ".") {
-      // Ignore "." path part (does nothing)
-      continue;
-    } else if (part == "..") {
-      // If ".." path part, then pop the most recently added path part if any.
-      if (!pathparts.empty()) pathparts.pop_back();
-    } else {
-      pathparts.push_back(std::move(part));
-    }
+  auto itkey = std::begin(keys);
+  for (map_type::iterator* it : iters) {
+    *it = itkey->first ? std::end(container()) : container().find(itkey->second);
+    ++itkey;
   }
+}
+
+std::string GenMap::make_full_key(const key_view_type& key) const {
+  assert_internal(m_location[0] == '/' || m_location.length() == 0);
+  assert_internal(m_location.back() != '/');
 
   std::string res{m_location};
-  for (const auto& part : pathparts) {
-    res += "/" + part;
+  GenMapKey::append_normalised(res, key);
+  return res;
+}
+
+typename GenMap::map_type::iterator GenMap::find_entry(const key_view_type& key) const {
+  detail::GenMapLookupTimer timer;
+#ifdef KRIMS_HAVE_CXX14
+  if (GenMapKey::is_normalised(key)) {
+    // The full key is just the concatenation of location and key,
+    // so search for it without building the concatenated string.
+    const size_t skip = (key.size() > 0 && key[0] == '/') ? 1 : 0;
+    const detail::GenMapSplitKey split_key{m_location.data(), m_location.size(),
+                                           key.data() + skip, key.size() - skip};
+    timer.normalised();
+    auto itkey = container().find(split_key);
+    timer.record(itkey != std::end(container()), [&] { return make_full_key(key); });
+    return itkey;
+  }
+#endif
+  const std::string full_key = make_full_key(key);
+  timer.normalised();
+  auto itkey = container().find(full_key);
+  timer.record(itkey != std::end(container()), [&] { return full_key; });
+  return itkey;
+}
+
+std::pair<typename GenMap::map_type::iterator, bool> GenMap::probe_entry(
+      const key_view_type& key, std::string& full_key) const {
+  detail::GenMapLookupTimer timer;
+  map_type& map = container();
+#ifdef KRIMS_HAVE_CXX14
+  if (GenMapKey::is_normalised(key)) {
+    // Only build the full key if it is needed for inserting the entry.
+    const size_t skip = (key.size() > 0 && key[0] == '/') ? 1 : 0;
+    const detail::GenMapSplitKey split_key{m_location.data(), m_location.size(),
+                                           key.data() + skip, key.size() - skip};
+    timer.normalised();
+    auto pos         = map.lower_bound(split_key);
+    const bool found = pos != std::end(map) && !map.key_comp()(split_key, pos->first);
+    timer.record(found, [&] { return make_full_key(key); });
+    if (!found) full_key = make_full_key(key);
+    return {pos, found};
   }
+#endif
+  full_key = make_full_key(key);
+  timer.normalised();
+  auto pos         = map.lower_bound(full_key);
+  const bool found = is_entry(map, pos, full_key);
+  timer.record(found, [&] { return full_key; });
+  return {pos, found};
+}
 
-  assert_internal(res.length() == 0 || res.back() != '/');
-  assert_internal(res.length() == 0 || res[0] == '/');
+typename GenMap::map_type::iterator GenMap::find_entry(const GenMapKey& key) const {
+  detail::GenMapLookupTimer timer;
+  const detail::GenMapStorage& storage = *m_storage_ptr;
+  if (key.m_cache_generation == storage.generation &&
+      key.m_cache_location == m_location) {
+    // The cached iterator is still valid and refers to the same
+    // location in the tree, so it points to the entry we want.
+    timer.normalised();
+    timer.record(true, [&] { return m_location + key.path(); }, true);
+    return key.m_cache_iter;
+  }
 
-  return res;
+  const std::string full_key = m_location + key.path();
+  timer.normalised();
+  auto itkey = container().find(full_key);
+  if (itkey != std::end(container())) {
+    key.m_cache_generation = storage.generation;
+    key.m_cache_location   = m_location;
+    key.m_cache_iter       = itkey;
+  }
+  timer.record(itkey != std::end(container()), [&] { return full_key; });
+  return itkey;
 }
 
 typename GenMap::iterator GenMap::begin(const std::string& path) {
@@ -126,24 +478,24 @@ typename GenMap::iterator GenMap::begin(const std::string& path) {
   //  the ones which follow next must all be below our current
   //  location or already well past it.)
   const std::string path_full = make_full_key(path);
-  return iterator(starting_keys_begin(*m_container_ptr, path_full), path_full);
+  return iterator(starting_keys_begin(container(), path_full), path_full);
 }
 
 typename GenMap::const_iterator GenMap::cbegin(const std::string& path) const {
   const std::string path_full = make_full_key(path);
-  return const_iterator(starting_keys_begin(*m_container_ptr, path_full), path_full);
+  return const_iterator(starting_keys_begin(container(), path_full), path_full);
 }
 
 typename GenMap::iterator GenMap::end(const std::string& path) {
   // Obtain the first key which does no longer start with the pull path,
   // i.e. where we are done processing the subpath.
   const std::string path_full = make_full_key(path);
-  return iterator(starting_keys_end(*m_container_ptr, path_full), path_full);
+  return iterator(starting_keys_end(container(), path_full), path_full);
 }
 
 typename GenMap::const_iterator GenMap::cend(const std::string& path) const {
   const std::string path_full = make_full_key(path);
-  return const_iterator(starting_keys_end(*m_container_ptr, path_full), path_full);
+  return const_iterator(starting_keys_end(container(), path_full), path_full);
 }
 
 }  // namespace krims
@@ -18,11 +18,31 @@
 //
 
 #pragma once
+#include "GenMapFingerprint.hh"
 #include "GenMapIterator.hh"
+#include "GenMapKey.hh"
+#include "GenMapWatch.hh"
 #include "Subscribable.hh"
+#include "detail/GenMapStorage.hh"
 
 namespace krims {
 
+class FrozenGenMap;
+class GenMap;
+template <typename T>
+class GenMapGatherPlan;
+template <typename... Ts>
+class GenMapSchema;
+template <typename... Ts>
+class GenMapSchemaHandle;
+GenMap read_genmap_snapshot(const std::string& file);
+GenMap mmap_genmap_snapshot(const std::string& file);
+#ifdef KRIMS_HAVE_POSIX_SHM
+GenMap attach_genmap_snapshot(const std::string& name);
+#endif
+GenMap read_genmap_config(const std::string& file);
+GenMap parse_genmap_config(const std::string& text, const std::string& name);
+
 /** GenMap implements a map from a std::string to objects of arbitrary
  *  type.
  *
@@ -42,6 +62,7 @@ class GenMap : public Subscribable {
  public:
   typedef typename detail::GenMapTraits::entry_value_type entry_value_type;
   typedef typename detail::GenMapTraits::map_type map_type;
+  typedef typename detail::GenMapTraits::key_view_type key_view_type;
   typedef std::pair<const std::string, entry_value_type> entry_type;
   typedef GenMapIterator<true> const_iterator;
   typedef GenMapIterator<false> iterator;
@@ -54,11 +75,30 @@ class GenMap : public Subscribable {
   ///@{
   /** \brief default constructor
    * Constructs empty map */
-  GenMap() : m_container_ptr{std::make_shared<map_type>()}, m_location{""} {}
+  GenMap() : m_storage_ptr{std::make_shared<detail::GenMapStorage>()}, m_location{""} {}
 
   /** \brief Construct parameter map from initialiser list of entry_types */
   GenMap(std::initializer_list<entry_type> il) : GenMap{} { update(il); };
 
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  /** \brief Construct an empty map, which allocates from an arena.
+   *
+   * The nodes of the map as well as the values inserted via update_emplace
+   * or update_copy are allocated from ``arena``. Together with a monotonic
+   * buffer resource this makes building and destroying short-lived maps cheap:
+   * ```
+   * GenMap params(std::make_shared<std::pmr::monotonic_buffer_resource>());
+   * params.update_emplace<double>("tolerance", 1e-8);
+   * ```
+   * The arena is kept alive until the map and all values allocated from it
+   * have been destroyed, so values may safely be shared with other maps.
+   * Copies and forks of the map allocate from the default heap.
+   */
+  explicit GenMap(std::shared_ptr<std::pmr::memory_resource> arena)
+        : m_storage_ptr{std::make_shared<detail::GenMapStorage>(std::move(arena))},
+          m_location{""} {}
+#endif
+
   ~GenMap()        = default;
   GenMap(GenMap&&) = default;
 
@@ -95,6 +135,44 @@ class GenMap : public Subscribable {
 
   /** \brief Assignment operator */
   GenMap& operator=(GenMap other);
+
+  /** \brief Make a copy of this map, which shares the storage of the
+   *  entries with this map until either of them is modified.
+   *
+   * The returned map behaves exactly like a copy made by the copy constructor
+   * (including the sharing of the data behind the entries, see its
+   * documentation). Forking takes constant time, since the internal storage
+   * of the keys and entries is shared between both maps until either of them
+   * is modified via ``update``, ``erase`` or any other function adding,
+   * replacing or removing entries. The first such modification copies all
+   * entries of the (sub)map, which costs as much as the copy constructor.
+   * Reading, iterating and modifying the data the entries point to (e.g. via
+   * ``at``) does not trigger a copy.
+   *
+   * So forking only saves the copy for maps which are not modified afterwards,
+   * e.g. versions of a map handed to readers. Deriving a slightly modified
+   * version of a map via fork and update is no cheaper than copying it.
+   *
+   * \note Copying the entries invalidates all iterators and references to
+   * raw values of the map in which the modification happens. So after
+   * forking, iterators of *this obtained before the fork should not be
+   * used past the next modification of *this.
+   */
+  GenMap fork() const;
+
+  /** \brief Make an immutable copy of this map, which is optimised for reading.
+   *
+   * The returned FrozenGenMap contains all entries of this map (or submap)
+   * in a contiguous sorted array, such that lookups are faster and cause
+   * fewer cache misses than lookups in the GenMap itself. Like the copy
+   * constructor only the pointers to the data are copied.
+   *
+   * Use this for maps which are set up once and read many times afterwards,
+   * e.g. parameter maps passed to hot loops. See FrozenGenMap for details.
+   *
+   * \note Requires including FrozenGenMap.hh.
+   */
+  FrozenGenMap freeze() const;
   ///@}
 
   /** \name Modifiers */
@@ -109,9 +187,14 @@ class GenMap : public Subscribable {
    *   - Shared pointers
    */
   void update(const std::string& key, entry_value_type e) {
-    (*m_container_ptr)[make_full_key(key)] = std::move(e);
+    std::string full_key = make_full_key(key);
+    m_storage_ptr->mark_modified(full_key);
+    m_storage_ptr->map_for_writing()[std::move(full_key)] = std::move(e);
   }
 
+  /** \brief Insert or update a key given as a pre-normalised GenMapKey. */
+  void update(const GenMapKey& key, entry_value_type e);
+
   /** \brief Update many entries using an initialiser list
    *
    * TODO More details, have an example
@@ -140,6 +223,10 @@ class GenMap : public Subscribable {
    * The entries are updated relative to the given key paths.
    * I.e. if key == "blubber" and the map \t map contairs "foo" and
    * "bar", then "blubber/foo" and "blubber/bar" will be updated.
+   *
+   * If ``other`` is the only map referring to its entries, the entries are
+   * moved over and other is left empty (requires C++17), otherwise they
+   * are copied as in the overload above.
    * */
   void update(const std::string& key, GenMap&& other);
 
@@ -158,41 +245,87 @@ class GenMap : public Subscribable {
   /** Insert or update a key with a copy of an element */
   template <typename T>
   void update_copy(std::string key, T object) {
-    (*m_container_ptr)[make_full_key(key)] =
-          entry_value_type{std::make_shared<T>(object)};
+    update_emplace<T>(key, std::move(object));
+  }
+
+  /** Insert or update a key with an object of type T constructed from ``args``.
+   *
+   * If the map allocates from an arena, the object is placed in the arena
+   * (see the constructor taking a memory resource).
+   */
+  template <typename T, typename... Args>
+  void update_emplace(const std::string& key, Args&&... args) {
+    update(key, entry_value_type{
+                      m_storage_ptr->make_value<T>(std::forward<Args>(args)...)});
   }
 
   /** Insert a default value for a key, i.e. no existing key will be touched,
    * only new ones inserted (That's why the method is still const)
+   *
+   * \return Whether the value has been inserted
    */
-  void insert_default(const std::string& key, entry_value_type e) const {
-    auto itkey = m_container_ptr->find(make_full_key(key));
-    if (itkey == std::end(*m_container_ptr)) {
-      // Key not found, hence insert default.
-      (*m_container_ptr)[make_full_key(key)] = std::move(e);
-    }
+  bool insert_default(const key_view_type& key, entry_value_type e) const {
+    return emplace_entry(key, [&e] { return std::move(e); }).second;
   }
 
+  /** Insert an object of type T constructed from ``args`` if the key does not
+   *  exist yet. Otherwise neither the map nor ``args`` are touched.
+   *
+   * In contrast to checking with exists() and inserting with update_emplace()
+   * the key is only normalised once and the map only searched once.
+   *
+   * \return Whether the value has been inserted
+   */
+  template <typename T, typename... Args>
+  bool try_emplace(const key_view_type& key, Args&&... args);
+
+  /** Return a reference to the value of type T at a key, which is inserted
+   *  as the result of ``factory()`` if the key does not exist yet.
+   *
+   * The key is only normalised once and the map only searched once. The
+   * factory is only called if the value is inserted.
+   *
+   * \return The reference to the value and whether it has been inserted
+   */
+  template <typename T, typename Factory>
+  std::pair<T&, bool> get_or_insert(const key_view_type& key, Factory&& factory);
+
+  /** Insert or update a key with a value, like update(), but report whether
+   *  the key has been newly inserted.
+   *
+   * \return true if the key has been inserted, false if it has been assigned
+   */
+  bool insert_or_assign(const key_view_type& key, entry_value_type e);
+
   /** Insert default values for many entries at once using an initialiser list.
    *
    * Only inserts values that do not already exist in the map
    * (That's why the method is const)
    */
-  void insert_default(std::initializer_list<entry_type> il) const {
-    for (entry_type t : il) {
-      insert_default(t.first, t.second);
-    }
-  }
+  void insert_default(std::initializer_list<entry_type> il) const;
 
   /** \brief Try to remove an element
    *  which is referenced by this string
    *
    *  \return The number of removed elements (i.e. 0 or 1)
    **/
-  size_t erase(const std::string& key) {
-    return m_container_ptr->erase(make_full_key(key));
+  size_t erase(const key_view_type& key) {
+    map_type& map = m_storage_ptr->map_for_writing();
+    auto itkey    = find_entry(key);
+    if (itkey == std::end(map)) return 0;
+
+    m_storage_ptr->mark_modified(itkey->first);
+    map.erase(itkey);
+    m_storage_ptr->invalidate_iterators();
+    return 1;
   }
 
+  /** \brief Try to remove an element referenced by a pre-normalised GenMapKey
+   *
+   *  \return The number of removed elements (i.e. 0 or 1)
+   **/
+  size_t erase(const GenMapKey& key);
+
   /** \brief Try to remove an element referenced by a key iterator
    *
    *  \return The iterator referencing the key *after* the last
@@ -202,7 +335,10 @@ class GenMap : public Subscribable {
     // Extract actual map iterator by converting to it explictly:
     typedef map_type::iterator mapiter;
     auto pos_conv = static_cast<typename map_type::iterator>(position);
-    mapiter res   = m_container_ptr->erase(pos_conv);
+    unshare_container({&pos_conv});
+    m_storage_ptr->mark_modified(pos_conv->first);
+    mapiter res = container().erase(pos_conv);
+    m_storage_ptr->invalidate_iterators();
     return iterator(std::move(res), m_location);
   }
 
@@ -216,7 +352,10 @@ class GenMap : public Subscribable {
     typedef map_type::iterator mapiter;
     auto first_conv = static_cast<typename map_type::iterator>(first);
     auto last_conv  = static_cast<typename map_type::iterator>(last);
-    mapiter res     = m_container_ptr->erase(first_conv, last_conv);
+    unshare_container({&first_conv, &last_conv});
+    m_storage_ptr->mark_modified(first_conv, last_conv);
+    mapiter res = container().erase(first_conv, last_conv);
+    m_storage_ptr->invalidate_iterators();
     return iterator(std::move(res), m_location);
   }
 
@@ -242,7 +381,7 @@ class GenMap : public Subscribable {
    *  with the specified type.
    *
    * If the value cannot be found an ExcUnknownKey is thrown.
-   * If the type requested is wrong the program is aborted.
+   * If the type requested is wrong an ExcWrongTypeRequested is thrown.
    *
    * \note This directly modifies the data in memory, so all
    * GenMap objects which internally refer to this data
@@ -253,8 +392,8 @@ class GenMap : public Subscribable {
    * copy constructor for details.
    */
   template <typename T>
-  T& at(const std::string& key) {
-    return at_raw_value(key).get<T>();
+  T& at(const key_view_type& key) {
+    return value_at(key).get<T>();
   }
 
   /** \brief Return a reference to the value at a given key
@@ -262,23 +401,23 @@ class GenMap : public Subscribable {
    * See non-const version for details.
    */
   template <typename T>
-  const T& at(const std::string& key) const {
+  const T& at(const key_view_type& key) const {
     return at_raw_value(key).get<T>();
   }
 
   /** \brief Get the value of an element.
    *
    * If the key cannot be found, returns the provided reference instead.
-   * If the type requested is wrong the program is aborted.
+   * If the type requested is wrong an ExcWrongTypeRequested is thrown.
    */
   template <typename T>
-  T& at(const std::string& key, T& default_value);
+  T& at(const key_view_type& key, T& default_value);
 
   /** \brief Get the value of an element (const version).
    * See non-const version for details.
    */
   template <typename T>
-  const T& at(const std::string& key, const T& default_value) const;
+  const T& at(const key_view_type& key, const T& default_value) const;
 
   /** \brief Return a pointer to the value of a specific key.
    *
@@ -293,8 +432,8 @@ class GenMap : public Subscribable {
    * Use the contains_shared_ptr() function to check this.
    */
   template <typename T>
-  RCPWrapper<T> at_ptr(const std::string& key) {
-    return at_raw_value(key).get_ptr<T>();
+  RCPWrapper<T> at_ptr(const key_view_type& key) {
+    return value_at(key).get_ptr<T>();
   }
 
   /** Return a pointer to the value of a specific key. (const version)
@@ -302,7 +441,7 @@ class GenMap : public Subscribable {
    * See non-const version for details
    */
   template <typename T>
-  RCPWrapper<const T> at_ptr(const std::string& key) const {
+  RCPWrapper<const T> at_ptr(const key_view_type& key) const {
     return at_raw_value(key).get_ptr<T>();
   }
 
@@ -310,13 +449,13 @@ class GenMap : public Subscribable {
   /** \brief Get the pointer to the value of a key or a default.
    *
    * If the key cannot be found, returns the provided pointer instead.
-   * If the type requested is wrong the program is aborted.
+   * If the type requested is wrong an ExcWrongTypeRequested is thrown.
    */
   template <typename T>
-  RCPWrapper<T> at_ptr(const std::string& key, RCPWrapper<T> default_ptr);
+  RCPWrapper<T> at_ptr(const key_view_type& key, RCPWrapper<T> default_ptr);
 
   template <typename T>
-  RCPWrapper<T> at_ptr(const std::string& key, std::shared_ptr<T> default_ptr) {
+  RCPWrapper<T> at_ptr(const key_view_type& key, std::shared_ptr<T> default_ptr) {
     return at_ptr(key, RCPWrapper<T>(default_ptr));
   }
   //@}
@@ -327,11 +466,11 @@ class GenMap : public Subscribable {
    *  See the non-const version for details.
    */
   template <typename T>
-  RCPWrapper<const T> at_ptr(const std::string& key,
+  RCPWrapper<const T> at_ptr(const key_view_type& key,
                              RCPWrapper<const T> default_ptr) const;
 
   template <typename T>
-  RCPWrapper<const T> at_ptr(const std::string& key,
+  RCPWrapper<const T> at_ptr(const key_view_type& key,
                              std::shared_ptr<const T> default_ptr) const {
     return at_ptr(key, RCPWrapper<const T>(default_ptr));
   }
@@ -340,44 +479,190 @@ class GenMap : public Subscribable {
   /** Return an GenMapValue object representing the data behind the specified key
    *
    * \note This is an advanced method. Use only if you know what you are doing.
+   * Like ``at`` this does not copy entries shared with a fork (see fork()),
+   * so the returned object should only be used to modify the data it points to.
    * */
-  detail::GenMapValue& at_raw_value(const std::string& key) {
-    auto itkey = m_container_ptr->find(make_full_key(key));
-    assert_throw(itkey != std::end(*m_container_ptr), ExcUnknownKey(key));
-    return itkey->second;
-  }
+  detail::GenMapValue& at_raw_value(const key_view_type& key) { return value_at(key); }
 
   /** Return an GenMapValue object representing the data behind the specified key
    * (const version)
    *
    * \note This is an advanced method. Use only if you know what you are doing.
    * */
-  const detail::GenMapValue& at_raw_value(const std::string& key) const {
-    auto itkey = m_container_ptr->find(make_full_key(key));
-    assert_throw(itkey != std::end(*m_container_ptr), ExcUnknownKey(key));
-    return itkey->second;
+  const detail::GenMapValue& at_raw_value(const key_view_type& key) const {
+    return value_at(key);
   }
   ///@}
 
   /** Check weather a key exists */
-  bool exists(const std::string& key) const {
-    return m_container_ptr->find(make_full_key(key)) != std::end(*m_container_ptr);
+  bool exists(const key_view_type& key) const {
+    return find_entry(key) != std::end(container());
   }
 
   /** Return a string which describes the type of the
    * stored data
    *
-   * \note This function only returns a senbible value if:
-   *   - The code is compiled in DEBUG mode
-   *   - The OS exposes an interface for type demangling.
-   *   - In RELEASE builds this function always returns
-   *     the string "<no typeinfo>".
+   * \note The type name is only demangled if the OS exposes an interface
+   * for type demangling.
+   */
+  std::string type_name_of(const key_view_type& key) const {
+    return at_raw_value(key).type_name();
+  }
+
+  /** Has the value of an entry already been computed.
+   *
+   * This is only false for entries which were stored as a LazyValue
+   * (see make_lazy) and have not yet been accessed by at or at_ptr.
+   */
+  bool is_evaluated(const key_view_type& key) const {
+    return at_raw_value(key).evaluated();
+  }
+
+  /** \brief Return a 128-bit fingerprint of the entries of a subtree.
    *
+   * The fingerprint combines the keys relative to ``path`` and the types
+   * of all entries at or below ``path``. For cheaply copyable values
+   * (numbers, enums and std::string) the values are included as well,
+   * for all other entries (e.g. objects stored via a shared pointer) only
+   * the key and type are. It is stable between runs of the same build of
+   * a program, such that it can be used as the key for caching results
+   * computed from the parameters in the subtree:
+   * ```
+   * GenMapFingerprint key = params.fingerprint("solver");
+   * auto it = cache.find(key);
+   * ```
+   * Equal subtrees have the same fingerprint, regardless of their location
+   * inside the map or in which map they are contained.
+   *
+   * Fingerprints of subtrees are cached inside the map, such that
+   * a repeated call is a single lookup. Inserting, updating or erasing an
+   * entry via the GenMap only drops the cached fingerprints of the subtrees
+   * containing the entry, such that recomputing the fingerprint of a
+   * large map after changing a few entries only rehashes the changed
+   * entries and the paths leading to them. Reading or iterating over the
+   * map keeps all cached fingerprints.
+   *
+   * \note Modifications of the data of an entry via a reference or pointer
+   * (e.g. obtained by ``at``) are not noticed. This especially includes
+   * modifications via other maps sharing the data (see the copy constructor).
+   * Use ``update`` to change the values of maps whose fingerprints are used.
    */
-  std::string type_name_of(const std::string& key) const {
+  GenMapFingerprint fingerprint(const std::string& path = "/") const;
+
+  /** \name Bulk access to the values of a subtree */
+  ///@{
+  /** \brief Copy the values of all entries at or below ``path`` to the array ``out``.
+   *
+   * The values are written in the order of the keys. All entries need to be of
+   * type T (else ExcWrongTypeRequested is thrown) and ``size`` needs to equal
+   * the number of entries (else ExcSizeMismatch is thrown):
+   * ```
+   * std::vector<double> weights(n_weights);
+   * map.gather("grid/weights", weights.data(), weights.size());
+   * ```
+   * For repeated gathers from the same subtree a GenMapGatherPlan is faster,
+   * since it only traverses the map once.
+   */
+  template <typename T>
+  void gather(const std::string& path, T* out, size_t size) const;
+
+  /** \brief Assign the values from the array ``in`` to the entries at or
+   *  below ``path`` in the order of the keys.
+   *
+   * The requirements are the same as for gather(). They are checked before
+   * any value is assigned, so the values are unchanged if an exception is
+   * thrown. Like assigning to the reference returned by ``at``, this modifies
+   * the data in memory, which may be shared with copies of this map.
+   */
+  template <typename T>
+  void scatter(const std::string& path, const T* in, size_t size);
+  ///@}
+
+  /** \name Watching for changes */
+  ///@{
+  /** \brief Subscribe to modifications of the entries at or below a path.
+   *
+   * Changes are not delivered immediately, but collected until the next
+   * call to flush(), which marks the returned watch as dirty and calls
+   * the callback once with the list of changed keys relative to ``path``
+   * (see GenMapWatch for details and an example).
+   *
+   * The subscription belongs to the storage of this map, such that changes
+   * made via any submap are noticed as well. Copies and forks of the map
+   * start without any watches. Like ``update``, subscribing a watch and
+   * flush() modify the storage, so they must not be called concurrently
+   * with other accesses to the map.
+   */
+  GenMapWatch watch(const std::string& path = "/",
+                    GenMapWatch::callback_type callback = nullptr);
+
+  /** \brief Deliver the changes made to the map since the last flush
+   *  to all affected watches.
+   *
+   * Callbacks may modify the map. These modifications are delivered
+   * on the next flush.
+   */
+  void flush();
+  ///@}
+
+  /** \name Access using pre-normalised keys
+   *
+   * These functions behave exactly like their counterparts taking a string
+   * key, but avoid the normalisation of the key and (if the entry the
+   * GenMapKey has been resolved to last time is still valid) the search
+   * inside the map as well. See GenMapKey for details.
+   */
+  ///@{
+  template <typename T>
+  T& at(const GenMapKey& key) {
+    return value_at(key).get<T>();
+  }
+
+  template <typename T>
+  const T& at(const GenMapKey& key) const {
+    return at_raw_value(key).get<T>();
+  }
+
+  template <typename T>
+  T& at(const GenMapKey& key, T& default_value);
+
+  template <typename T>
+  const T& at(const GenMapKey& key, const T& default_value) const;
+
+  template <typename T>
+  RCPWrapper<T> at_ptr(const GenMapKey& key) {
+    return value_at(key).get_ptr<T>();
+  }
+
+  template <typename T>
+  RCPWrapper<const T> at_ptr(const GenMapKey& key) const {
+    return at_raw_value(key).get_ptr<T>();
+  }
+
+  template <typename T>
+  RCPWrapper<T> at_ptr(const GenMapKey& key, RCPWrapper<T> default_ptr);
+
+  template <typename T>
+  RCPWrapper<const T> at_ptr(const GenMapKey& key,
+                             RCPWrapper<const T> default_ptr) const;
+
+  detail::GenMapValue& at_raw_value(const GenMapKey& key) { return value_at(key); }
+
+  const detail::GenMapValue& at_raw_value(const GenMapKey& key) const {
+    return value_at(key);
+  }
+
+  bool exists(const GenMapKey& key) const {
+    return find_entry(key) != std::end(container());
+  }
+
+  std::string type_name_of(const GenMapKey& key) const {
     return at_raw_value(key).type_name();
   }
 
+  bool is_evaluated(const GenMapKey& key) const { return at_raw_value(key).evaluated(); }
+  ///@}
+
   /** \name Submaps */
   ///@{
   /** \brief Get a submap starting pointing at a different location.
@@ -490,20 +775,114 @@ class GenMap : public Subscribable {
    * doing.
    **/
   GenMap(const GenMap& other, std::string newlocation)
-        : m_container_ptr{other.m_container_ptr},
+        : m_storage_ptr{other.m_storage_ptr},
           m_location{other.make_full_key(newlocation)} {}
 
  private:
+  template <typename T>
+  friend class GenMapGatherPlan;
+  template <typename... Ts>
+  friend class GenMapSchema;
+  template <typename... Ts>
+  friend class GenMapSchemaHandle;
+  friend GenMap read_genmap_snapshot(const std::string& file);
+  friend GenMap mmap_genmap_snapshot(const std::string& file);
+#ifdef KRIMS_HAVE_POSIX_SHM
+  friend GenMap attach_genmap_snapshot(const std::string& name);
+#endif
+  friend GenMap read_genmap_config(const std::string& file);
+  friend GenMap parse_genmap_config(const std::string& text, const std::string& name);
+
   /** Make the actual container key from a key supplied by the user
    *  Care is taken such that we cannot escape the subtree.
    * */
-  std::string make_full_key(const std::string& key) const;
+  std::string make_full_key(const key_view_type& key) const;
+
+  /** Return the map of the storage this object refers to.
+   *
+   * Only the data the entry values point to may be modified via
+   * the returned reference, see container_for_writing().
+   */
+  map_type& container() const { return *m_storage_ptr->map_ptr; }
 
-  /** Return an iterator which points to the first key-value pair where the key begins
-   * with the provided string ``start``.
+  /** Return the map of the storage this object refers to for modification
    *
-   * Together with map_starting_keys_end this allows to iterate over a range of
-   * values in the map, where the keys start with ``start``.
+   * If the map is still shared with a GenMap obtained via fork(),
+   * a copy is made first. Since any entry may be modified via the returned
+   * reference, all cached fingerprints are dropped. This is only meant for
+   * replacing or clearing the whole map. Functions modifying only a few known
+   * entries should use m_storage_ptr->map_for_writing() and
+   * m_storage_ptr->mark_modified(key) instead and functions only reading the
+   * entries container(). Changes made via the returned reference are not
+   * reported to the watches (see watch()).
+   */
+  map_type& container_for_writing() const {
+    m_storage_ptr->invalidate_fingerprints();
+    return m_storage_ptr->map_for_writing();
+  }
+
+  /** Make sure the map of the storage is not shared with a GenMap obtained
+   * via fork() any more. The iterators pointed to by ``iters``
+   * are adjusted to point to the equivalent entries afterwards.
+   */
+  void unshare_container(std::initializer_list<map_type::iterator*> iters) const;
+
+  //@{
+  /** Return the value at a key or throw ExcUnknownKey.
+   *
+   * The map is not unshared, so only the data the value points to may
+   * be modified via the returned reference.
+   */
+  detail::GenMapValue& value_at(const key_view_type& key) const {
+    auto itkey = find_entry(key);
+    assert_throw(itkey != std::end(container()), ExcUnknownKey(std::string(key)));
+    return itkey->second;
+  }
+
+  detail::GenMapValue& value_at(const GenMapKey& key) const {
+    auto itkey = find_entry(key);
+    assert_throw(itkey != std::end(container()), ExcUnknownKey(key.path()));
+    return itkey->second;
+  }
+  //@}
+
+  /** Find the map entry corresponding to a key (or the end iterator)
+   *
+   * If the key is already normalised, no temporary string is built
+   * for the search (requires C++14 heterogeneous lookup).
+   */
+  map_type::iterator find_entry(const key_view_type& key) const;
+
+  /** Search for the position of the entry corresponding to a key, i.e. the
+   *  first entry not less than the key.
+   *
+   * \return The position and whether it is the entry for the key. If it is
+   *  not, ``full_key`` is set to the full key under which to insert the entry.
+   */
+  std::pair<map_type::iterator, bool> probe_entry(const key_view_type& key,
+                                                  std::string& full_key) const;
+
+  /** Find the map entry corresponding to a key or insert the value returned by
+   *  ``make_value()`` if there is none. The key is normalised only once and
+   *  the map is searched only once.
+   *
+   * \return The iterator to the entry and whether it has been inserted
+   */
+  template <typename MakeValue>
+  std::pair<map_type::iterator, bool> emplace_entry(const key_view_type& key,
+                                                    MakeValue&& make_value) const;
+
+  /** Find the map entry corresponding to a GenMapKey (or the end iterator)
+   *
+   * The result is cached inside the key if the entry could be found.
+   */
+  map_type::iterator find_entry(const GenMapKey& key) const;
+
+  /** Return an iterator which points to the first key-value pair where the key
+   * is equal to the full key ``start`` or is located in the subtree below it.
+   *
+   * Together with starting_keys_end this allows to iterate over a range of
+   * values in the map, where the keys are ``start`` or start with ``start + "/"``.
    */
   template <typename Map>
   static auto starting_keys_begin(Map& map, const std::string& start)
@@ -511,17 +890,20 @@ class GenMap : public Subscribable {
     return map.lower_bound(start);
   }
 
-  /** Return an iterator which points to the first key-value pair where the key does
-   * not begin with the with the provided string ``start``.
+  /** Return an iterator which points to the first key-value pair past the
+   * subtree below the full key ``start``.
    *
-   * Together with map_starting_keys_begin this allows to iterate over a range of
-   * values in the map, where the keys start with ``start``.
+   * Together with starting_keys_begin this allows to iterate over a range of
+   * values in the map, where the keys are ``start`` or start with ``start + "/"``.
+   * Both are a single search in the map.
    */
   template <typename Map>
   static auto starting_keys_end(Map& map, const std::string& start)
         -> decltype(std::end(map));
 
-  std::shared_ptr<map_type> m_container_ptr;
+  /** The storage object containing the actual data.
+   *  It is shared between a GenMap and all its submaps. */
+  std::shared_ptr<detail::GenMapStorage> m_storage_ptr;
 
   /** The location we are currently on in the tree
    * may not end with a slash (but a full key like "/tree"
@@ -533,10 +915,87 @@ class GenMap : public Subscribable {
 // -----------------------------------------------------------------
 //
 
+template <typename T, typename... Args>
+bool GenMap::try_emplace(const key_view_type& key, Args&&... args) {
+  auto make_value = [&] {
+    return entry_value_type{m_storage_ptr->make_value<T>(std::forward<Args>(args)...)};
+  };
+  return emplace_entry(key, make_value).second;
+}
+
+template <typename T, typename Factory>
+std::pair<T&, bool> GenMap::get_or_insert(const key_view_type& key, Factory&& factory) {
+  auto make_value = [&] {
+    return entry_value_type{m_storage_ptr->make_value<T>(factory())};
+  };
+  auto res = emplace_entry(key, make_value);
+  return std::pair<T&, bool>(res.first->second.template get<T>(), res.second);
+}
+
+template <typename MakeValue>
+std::pair<typename GenMap::map_type::iterator, bool> GenMap::emplace_entry(
+      const key_view_type& key, MakeValue&& make_value) const {
+  std::string full_key;
+  auto probe = probe_entry(key, full_key);
+  if (probe.second) return {probe.first, false};
+
+  map_type::iterator pos;
+  if (m_storage_ptr->is_shared()) {
+    // Unshare the map, which invalidates the position from the probe
+    map_type& map = m_storage_ptr->map_for_writing();
+    pos           = map.emplace(std::move(full_key), make_value()).first;
+  } else {
+    pos = container().emplace_hint(probe.first, std::move(full_key), make_value());
+  }
+  m_storage_ptr->mark_modified(pos->first);
+  return {pos, true};
+}
+
+template <typename T>
+T& GenMap::at(const key_view_type& key, T& default_value) {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
+    return default_value;  // Key not found
+  } else {
+    return itkey->second.get<T>();
+  }
+}
+
+template <typename T>
+const T& GenMap::at(const key_view_type& key, const T& default_value) const {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
+    return default_value;  // Key not found
+  } else {
+    return itkey->second.get<T>();
+  }
+}
+
+template <typename T>
+RCPWrapper<T> GenMap::at_ptr(const key_view_type& key, RCPWrapper<T> default_ptr) {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
+    return default_ptr;  // Key not found
+  } else {
+    return itkey->second.get_ptr<T>();
+  }
+}
+
+template <typename T>
+RCPWrapper<const T> GenMap::at_ptr(const key_view_type& key,
+                                   RCPWrapper<const T> default_ptr) const {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
+    return default_ptr;  // Key not found
+  } else {
+    return itkey->second.get_ptr<T>();
+  }
+}
+
 template <typename T>
-T& GenMap::at(const std::string& key, T& default_value) {
-  auto itkey = m_container_ptr->find(make_full_key(key));
-  if (itkey == std::end(*m_container_ptr)) {
+T& GenMap::at(const GenMapKey& key, T& default_value) {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
     return default_value;  // Key not found
   } else {
     return itkey->second.get<T>();
@@ -544,9 +1003,9 @@ T& GenMap::at(const std::string& key, T& default_value) {
 }
 
 template <typename T>
-const T& GenMap::at(const std::string& key, const T& default_value) const {
-  auto itkey = m_container_ptr->find(make_full_key(key));
-  if (itkey == std::end(*m_container_ptr)) {
+const T& GenMap::at(const GenMapKey& key, const T& default_value) const {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
     return default_value;  // Key not found
   } else {
     return itkey->second.get<T>();
@@ -554,9 +1013,9 @@ const T& GenMap::at(const std::string& key, const T& default_value) const {
 }
 
 template <typename T>
-RCPWrapper<T> GenMap::at_ptr(const std::string& key, RCPWrapper<T> default_ptr) {
-  auto itkey = m_container_ptr->find(make_full_key(key));
-  if (itkey == std::end(*m_container_ptr)) {
+RCPWrapper<T> GenMap::at_ptr(const GenMapKey& key, RCPWrapper<T> default_ptr) {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
     return default_ptr;  // Key not found
   } else {
     return itkey->second.get_ptr<T>();
@@ -564,30 +1023,62 @@ RCPWrapper<T> GenMap::at_ptr(const std::string& key, RCPWrapper<T> default_ptr)
 }
 
 template <typename T>
-RCPWrapper<const T> GenMap::at_ptr(const std::string& key,
+RCPWrapper<const T> GenMap::at_ptr(const GenMapKey& key,
                                    RCPWrapper<const T> default_ptr) const {
-  auto itkey = m_container_ptr->find(make_full_key(key));
-  if (itkey == std::end(*m_container_ptr)) {
+  auto itkey = find_entry(key);
+  if (itkey == std::end(container())) {
     return default_ptr;  // Key not found
   } else {
     return itkey->second.get_ptr<T>();
   }
 }
 
+template <typename T>
+void GenMap::gather(const std::string& path, T* out, size_t size) const {
+  const std::string path_full = make_full_key(path);
+  const map_type& map         = container();
+  const auto first            = starting_keys_begin(map, path_full);
+  const auto last             = starting_keys_end(map, path_full);
+
+  size_t i = 0;
+  for (auto it = first; it != last; ++it, ++i) {
+    assert_throw(i < size, ExcSizeMismatch(
+                                 static_cast<size_t>(std::distance(first, last)), size));
+    out[i] = it->second.get<T>();
+  }
+  assert_throw(i == size, ExcSizeMismatch(i, size));
+}
+
+template <typename T>
+void GenMap::scatter(const std::string& path, const T* in, size_t size) {
+  const std::string path_full = make_full_key(path);
+  map_type& map               = container();
+  const auto first            = starting_keys_begin(map, path_full);
+  const auto last             = starting_keys_end(map, path_full);
+
+  // Check the size and all types before modifying anything, such that
+  // a failing scatter leaves the values untouched.
+  const size_t n_entries = static_cast<size_t>(std::distance(first, last));
+  assert_throw(n_entries == size, ExcSizeMismatch(n_entries, size));
+  for (auto it = first; it != last; ++it) (void)it->second.get<T>();
+
+  m_storage_ptr->invalidate_fingerprints(path_full);
+  size_t i = 0;
+  for (auto it = first; it != last; ++it, ++i) it->second.get<T>() = in[i];
+}
+
 template <typename Map>
 auto GenMap::starting_keys_end(Map& map, const std::string& start)
       -> decltype(std::end(map)) {
   // If start is empty, then we iterate over the full map:
   if (start.length() == 0) return std::end(map);
 
-  // Seek to the first key-value pair which is no longer part
-  // of the range we care about, i.e. which does not start with the
-  // provided start string.
-  auto it = starting_keys_begin(map, start);
-  for (; it != std::end(map); ++it) {
-    if (0 != it->first.compare(0, start.length(), start)) break;
-  }
-  return it;
+  // All keys of the subtree are ordered directly after start and before
+  // start + '\0' (see detail::GenMapKeyLess), so the end of the range
+  // can be found by a single search.
+  std::string bound{start};
+  bound.push_back('\0');
+  return map.lower_bound(bound);
 }
 
 }  // namespace krims
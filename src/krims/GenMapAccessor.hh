@@ -23,24 +23,33 @@
 namespace krims {
 
 /** Accessor to a GenMap object. Can be used to retrieve the key or the value
- *  or the typename of the value */
+ *  or the typename of the value
+ *
+ *  The accessor returned by an iterator only refers to the key and the value,
+ *  so it is only valid as long as the iterator it was obtained from is not
+ *  changed. Copies of an accessor hold a copy of the key and only refer to
+ *  the value, so they stay valid as long as the entry exists.
+ */
 template <bool Const>
 class GenMapAccessor {};
 
+template <bool Const, typename Iter>
+class GenMapIterator;
+
 template <>
 class GenMapAccessor<true> {
  public:
   typedef detail::GenMapTraits::entry_value_type entry_value_type;
 
   /** Return the key of the key/value pair the accessor holds */
-  const std::string& key() const { return m_key; }
+  const std::string& key() const { return *m_key_ptr; }
 
   /** Return the type name of the value object referred to by the key, which
    * is held in this accessor.
    *
-   * The type_name is only sensible in DEBUG mode.
+   * The type_name is only demangled if the OS supports this.
    */
-  std::string type_name() const { return m_value.type_name(); }
+  std::string type_name() const { return m_value_ptr->type_name(); }
 
   /** Return the value of the key/value pair the accessor holds (Const version).
    *
@@ -49,7 +58,7 @@ class GenMapAccessor<true> {
    **/
   template <typename T>
   const T& value() const {
-    return m_value.get<T>();
+    return m_value_ptr->get<T>();
   }
 
   /** Return the value of the key/value pair the accessor holds
@@ -60,22 +69,59 @@ class GenMapAccessor<true> {
    **/
   template <typename T>
   RCPWrapper<const T> value_ptr() const {
-    return m_value.get_ptr<T>();
+    return m_value_ptr->get_ptr<T>();
   }
 
   /** Return a reference to the raw value object the accessor holds. (Const version)
    *
    * \note This is an advanced method. Use only if you know what you are doing.
    **/
-  const entry_value_type& value_raw() const { return m_value; }
+  const entry_value_type& value_raw() const { return *m_value_ptr; }
+
+  /** Construct an accessor referring to a key and a value
+   *  (both need to outlive the accessor) */
+  GenMapAccessor(const std::string& key, const entry_value_type& value)
+        : m_key{}, m_key_ptr(&key), m_value_ptr(&value) {}
+
+  //@{
+  /** Copy and assignment (the key is copied, since the key referred to
+   *  may be the key buffer of an iterator, which is reused) */
+  GenMapAccessor(const GenMapAccessor& other)
+        : m_key(other.m_key_ptr == nullptr ? std::string() : *other.m_key_ptr),
+          m_key_ptr(&m_key),
+          m_value_ptr(other.m_value_ptr) {}
+
+  GenMapAccessor& operator=(const GenMapAccessor& other) {
+    if (this != &other) {
+      m_key       = other.m_key_ptr == nullptr ? std::string() : *other.m_key_ptr;
+      m_key_ptr   = &m_key;
+      m_value_ptr = other.m_value_ptr;
+    }
+    return *this;
+  }
+  //@}
+
+ protected:
+  template <bool, typename>
+  friend class GenMapIterator;
 
-  /** Construct an accessor */
-  GenMapAccessor(const std::string key, const entry_value_type& value)
-        : m_key(key), m_value(value) {}
+  /** Construct an accessor referring to nothing */
+  GenMapAccessor() : m_key{}, m_key_ptr(nullptr), m_value_ptr(nullptr) {}
+
+  /** Make the accessor refer to another key and value without copying
+   *  the key (both need to outlive the accessor) */
+  void refer_to(const std::string& key, const entry_value_type& value) {
+    m_key_ptr   = &key;
+    m_value_ptr = &value;
+  }
 
  private:
-  const std::string m_key;
-  const entry_value_type& m_value;
+  //! Copy of the key for accessors, which have been copied
+  std::string m_key;
+
+  //! The key of the entry (either m_key or a key owned by someone else)
+  const std::string* m_key_ptr;
+  const entry_value_type* m_value_ptr;
 };
 
 template <>
@@ -93,7 +139,7 @@ class GenMapAccessor<false> : public GenMapAccessor<true> {
    **/
   template <typename T>
   T& value() {
-    return m_value.get<T>();
+    return m_value_ptr->get<T>();
   }
 
   /** Return the value of the key/value pair the accessor holds
@@ -104,7 +150,7 @@ class GenMapAccessor<false> : public GenMapAccessor<true> {
    **/
   template <typename T>
   RCPWrapper<T> value_ptr() {
-    return m_value.get_ptr<T>();
+    return m_value_ptr->get_ptr<T>();
   }
 
   /** Return the value of the key/value pair the accessor holds (Const version).
@@ -114,7 +160,7 @@ class GenMapAccessor<false> : public GenMapAccessor<true> {
    **/
   template <typename T>
   const T& value() const {
-    return m_value.get<T>();
+    return m_value_ptr->get<T>();
   }
 
   /** Return the value of the key/value pair the accessor holds
@@ -125,27 +171,44 @@ class GenMapAccessor<false> : public GenMapAccessor<true> {
    **/
   template <typename T>
   RCPWrapper<const T> value_ptr() const {
-    return m_value.get_ptr<T>();
+    return m_value_ptr->get_ptr<T>();
   }
 
   /** Return a reference to the raw value object the accessor holds. ( Const version)
    *
    * \note This is an advanced method. Use only if you know what you are doing.
    **/
-  const entry_value_type& value_raw() const { return m_value; }
+  const entry_value_type& value_raw() const { return *m_value_ptr; }
 
   /** Return a reference to the raw value object the accessor holds.
    *
    * \note This is an advanced method. Use only if you know what you are doing.
+   * The entry may be shared with a fork of the map (see GenMap::fork), so
+   * only the data the value object points to should be modified.
    **/
-  entry_value_type& value_raw() { return m_value; }
+  entry_value_type& value_raw() { return *m_value_ptr; }
+
+  /** Construct an accessor referring to a key and a value
+   *  (both need to outlive the accessor) */
+  GenMapAccessor(const std::string& key, entry_value_type& value)
+        : base_type(key, value), m_value_ptr(&value) {}
+
+ protected:
+  template <bool, typename>
+  friend class GenMapIterator;
 
-  /** Construct an accessor */
-  GenMapAccessor(const std::string key, entry_value_type& value)
-        : base_type(key, value), m_value(value) {}
+  /** Construct an accessor referring to nothing */
+  GenMapAccessor() : base_type(), m_value_ptr(nullptr) {}
+
+  /** Make the accessor refer to another key and value without copying
+   *  the key (both need to outlive the accessor) */
+  void refer_to(const std::string& key, entry_value_type& value) {
+    base_type::refer_to(key, value);
+    m_value_ptr = &value;
+  }
 
  private:
-  entry_value_type& m_value;
+  entry_value_type* m_value_ptr;
 };
 
 }  // namespace krims
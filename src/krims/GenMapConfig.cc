@@ -0,0 +1,263 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "GenMapConfig.hh"
+#include "DataFiles/MappedFile.hh"
+#include <climits>
+#include <cstring>
+
+#ifdef KRIMS_HAVE_FROM_CHARS
+#include <charconv>
+#else
+#include <cerrno>
+#include <cstdlib>
+#endif
+
+namespace krims {
+
+namespace {
+typedef detail::GenMapTraits::map_type map_type;
+
+/** A range of characters inside the text being parsed */
+struct Token {
+  const char* begin;
+  const char* end;
+
+  bool empty() const { return begin == end; }
+  size_t size() const { return static_cast<size_t>(end - begin); }
+
+  /** Return a pointer to the first occurrence of c or nullptr */
+  const char* find(char c) const {
+    return static_cast<const char*>(std::memchr(begin, c, size()));
+  }
+
+  bool equals(const char* str) const {
+    const size_t str_size = std::strlen(str);
+    return size() == str_size && std::memcmp(begin, str, str_size) == 0;
+  }
+  detail::GenMapTraits::key_view_type view() const {
+    return detail::GenMapTraits::key_view_type(begin, size());
+  }
+};
+
+bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+/** Remove leading and trailing whitespace */
+Token trim(Token tok) {
+  while (!tok.empty() && is_blank(*tok.begin)) ++tok.begin;
+  while (!tok.empty() && is_blank(*(tok.end - 1))) --tok.end;
+  return tok;
+}
+
+/** Is the token empty or a comment */
+bool is_blank_or_comment(Token tok) {
+  tok = trim(tok);
+  return tok.empty() || *tok.begin == '#' || *tok.begin == ';';
+}
+
+/** State of the parser, used for error reporting */
+struct ParseState {
+  const std::string& name;
+  size_t line;
+
+  void assert_syntax(bool condition, const std::string& message) const {
+    assert_throw(condition, ExcConfigSyntaxError(name, line, message));
+  }
+};
+
+/** Parse a quoted string value, where tok starts with the opening quote. */
+std::string parse_quoted(Token tok, const ParseState& state) {
+  const char quote = *tok.begin++;
+  std::string res;
+  for (; !tok.empty() && *tok.begin != quote; ++tok.begin) {
+    if (quote == '\'' || *tok.begin != '\\') {
+      res.push_back(*tok.begin);
+      continue;
+    }
+
+    // Escape sequence
+    ++tok.begin;
+    state.assert_syntax(!tok.empty(), "Unterminated string.");
+    switch (*tok.begin) {
+      case '\\':
+      case '"':
+        res.push_back(*tok.begin);
+        break;
+      case 'n':
+        res.push_back('\n');
+        break;
+      case 't':
+        res.push_back('\t');
+        break;
+      default:
+        state.assert_syntax(false, std::string("Unknown escape sequence \\") +
+                                         *tok.begin + ".");
+    }
+  }
+  state.assert_syntax(!tok.empty(), "Unterminated string.");
+  state.assert_syntax(is_blank_or_comment({tok.begin + 1, tok.end}),
+                      "Unexpected characters after string.");
+  return res;
+}
+
+//@{
+/** Try to parse the full token as a number of the given type */
+#ifdef KRIMS_HAVE_FROM_CHARS
+bool parse_number(Token tok, long& out) {
+  const auto res = std::from_chars(tok.begin, tok.end, out);
+  return res.ec == std::errc() && res.ptr == tok.end;
+}
+
+bool parse_number(Token tok, double& out) {
+  const auto res = std::from_chars(tok.begin, tok.end, out);
+  return res.ec == std::errc() && res.ptr == tok.end;
+}
+#else
+bool parse_number(Token tok, long& out) {
+  const std::string str(tok.begin, tok.end);
+  char* end = nullptr;
+  errno     = 0;
+  out       = std::strtol(str.c_str(), &end, 10);
+  return errno == 0 && end == str.c_str() + str.size();
+}
+
+bool parse_number(Token tok, double& out) {
+  const std::string str(tok.begin, tok.end);
+  char* end = nullptr;
+  errno     = 0;
+  out       = std::strtod(str.c_str(), &end);
+  return errno == 0 && end == str.c_str() + str.size();
+}
+#endif
+//@}
+
+/** Parse a value token and return the entry value */
+detail::GenMapValue parse_value(Token tok, const ParseState& state) {
+  if (!tok.empty() && (*tok.begin == '"' || *tok.begin == '\'')) {
+    return parse_quoted(tok, state);
+  }
+
+  // Strip a trailing comment, i.e. a '#' preceded by whitespace.
+  for (const char* c = tok.begin; c != tok.end; ++c) {
+    if (*c == '#' && c != tok.begin && is_blank(*(c - 1))) {
+      tok.end = c;
+      break;
+    }
+  }
+  tok = trim(tok);
+
+  if (tok.equals("true")) return true;
+  if (tok.equals("false")) return false;
+
+  // std::from_chars does not accept a leading '+'
+  Token number = tok;
+  if (number.end - number.begin > 1 && *number.begin == '+' && number.begin[1] != '-') {
+    ++number.begin;
+  }
+
+  long integer;
+  if (parse_number(number, integer)) {
+    if (integer >= INT_MIN && integer <= INT_MAX) return static_cast<int>(integer);
+    return integer;
+  }
+  double floating;
+  if (parse_number(number, floating)) return floating;
+
+  return std::string(tok.begin, tok.end);
+}
+
+/** Insert or replace an entry of the map.
+ *
+ * The entry is expected to belong directly in front of ``hint``, which is
+ * checked with two comparisons. Only if this is not the case the map
+ * is searched. Returns the iterator past the entry, i.e. the hint for the
+ * next entry in sorted order.
+ */
+map_type::iterator insert_entry(map_type& map, map_type::iterator hint,
+                                const std::string& key, detail::GenMapValue&& value) {
+  const auto comp    = map.key_comp();
+  const bool hint_ok = (hint == std::end(map) || comp(key, hint->first)) &&
+                       (hint == std::begin(map) || comp(std::prev(hint)->first, key));
+  const auto pos = hint_ok ? hint : map.lower_bound(key);
+
+  if (pos != std::end(map) && !comp(key, pos->first)) {
+    pos->second = std::move(value);
+    return std::next(pos);
+  }
+  map.emplace_hint(pos, key, std::move(value));
+  return pos;
+}
+
+/** Parse the text in [begin, end) into a map */
+map_type parse_config(const char* begin, const char* end, const std::string& name) {
+  map_type map;
+  auto hint = std::end(map);
+  ParseState state{name, 0};
+
+  std::string section;  // Full key of the current section
+  std::string full_key;
+  for (const char* pos = begin; pos != end;) {
+    ++state.line;
+    const char* eol      = Token{pos, end}.find('\n');
+    if (eol == nullptr) eol = end;
+    const Token line_tok = trim({pos, eol});
+    pos                  = eol == end ? end : eol + 1;
+    if (is_blank_or_comment(line_tok)) continue;
+
+    if (*line_tok.begin == '[') {
+      const char* close = line_tok.find(']');
+      state.assert_syntax(close != nullptr, "Missing ']' after section name.");
+      state.assert_syntax(is_blank_or_comment({close + 1, line_tok.end}),
+                          "Unexpected characters after section name.");
+
+      section.clear();
+      GenMapKey::append_normalised(section, trim({line_tok.begin + 1, close}).view());
+      continue;
+    }
+
+    const char* eq = line_tok.find('=');
+    state.assert_syntax(eq != nullptr, "Expected a line of the form 'key = value'.");
+    const Token key = trim({line_tok.begin, eq});
+    state.assert_syntax(!key.empty(), "Empty key.");
+
+    full_key.assign(section);
+    GenMapKey::append_normalised(full_key, key.view());
+    detail::GenMapValue value = parse_value(trim({eq + 1, line_tok.end}), state);
+    hint = insert_entry(map, hint, full_key, std::move(value));
+  }
+  return map;
+}
+}  // namespace
+
+GenMap read_genmap_config(const std::string& file) {
+  const MappedFile mapped(file);
+  GenMap res;
+  res.container_for_writing() =
+        parse_config(mapped.data(), mapped.data() + mapped.size(), file);
+  return res;
+}
+
+GenMap parse_genmap_config(const std::string& text, const std::string& name) {
+  GenMap res;
+  res.container_for_writing() =
+        parse_config(text.data(), text.data() + text.size(), name);
+  return res;
+}
+
+}  // namespace krims
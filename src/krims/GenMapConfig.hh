@@ -0,0 +1,76 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "GenMap.hh"
+
+namespace krims {
+
+/** Exception thrown if a config file or string cannot be parsed */
+DefException3(ExcConfigSyntaxError, std::string, size_t, std::string,
+              << "Syntax error in \"" << arg1 << "\", line " << arg2 << ": " << arg3);
+
+/** \brief Read a GenMap from a text file in a simple INI-like config format.
+ *
+ * The format consists of lines of the form ``key = value``. Sections
+ * like ``[solver/level1]`` select the submap into which all following
+ * entries are placed, entries before the first section are placed
+ * into the root of the map. Keys and section names are normalised like
+ * all GenMap paths. Empty lines and lines starting with ``#`` or ``;``
+ * are ignored, further a ``#`` preceded by whitespace starts a comment
+ * after an unquoted value. An example:
+ * ```
+ * # Global flags
+ * verbose = true
+ *
+ * [solver]
+ * tolerance = 1e-6      # stored as double
+ * max_iter  = 100       # stored as int
+ * method    = davidson  # stored as std::string
+ * guess     = "sad # 2" # quoted, with the escapes \" \\ \n and \t
+ *
+ * [solver/level1]
+ * param = 0.5           # key "solver/level1/param"
+ * ```
+ * The type of a value is deduced from its text: ``true`` and ``false``
+ * are stored as bool, integers as int (or long if they exceed the range
+ * of an int), other numbers as double and everything else as std::string.
+ * Text enclosed in single quotes is used verbatim. If a key occurs more
+ * than once, the last value is used.
+ *
+ * The file is mapped into memory (see MappedFile) and tokenised in place,
+ * such that only the keys and string values of the resulting map are copied
+ * out of it. Numbers are parsed with std::from_chars if available.
+ * Since entries in config files are usually grouped by section, the entries
+ * are inserted using the previous insertion point as a hint, which makes
+ * loading sorted files linear in the number of entries.
+ *
+ * Throws ExcConfigSyntaxError if the file cannot be parsed.
+ */
+GenMap read_genmap_config(const std::string& file);
+
+/** \brief Parse a GenMap from a string in the config format
+ *  described in read_genmap_config.
+ *
+ * In error messages the string is referred to by ``name``.
+ */
+GenMap parse_genmap_config(const std::string& text,
+                           const std::string& name = "<string>");
+
+}  // namespace krims
@@ -0,0 +1,57 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace krims {
+
+/** \brief A 128-bit fingerprint of the content of a GenMap or a subtree of it.
+ *
+ * See GenMap::fingerprint for details. Can be compared and used as a key
+ * in ordered and unordered containers.
+ */
+struct GenMapFingerprint {
+  uint64_t low;
+  uint64_t high;
+};
+
+inline bool operator==(const GenMapFingerprint& lhs, const GenMapFingerprint& rhs) {
+  return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+
+inline bool operator!=(const GenMapFingerprint& lhs, const GenMapFingerprint& rhs) {
+  return !(lhs == rhs);
+}
+
+inline bool operator<(const GenMapFingerprint& lhs, const GenMapFingerprint& rhs) {
+  return lhs.high < rhs.high || (lhs.high == rhs.high && lhs.low < rhs.low);
+}
+
+}  // namespace krims
+
+namespace std {
+template <>
+struct hash<krims::GenMapFingerprint> {
+  size_t operator()(const krims::GenMapFingerprint& fingerprint) const {
+    return static_cast<size_t>(fingerprint.low);
+  }
+};
+}  // namespace std
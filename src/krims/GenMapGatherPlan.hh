@@ -0,0 +1,138 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "GenMap.hh"
+#include <type_traits>
+#include <vector>
+
+namespace krims {
+
+/** \brief Plan for the repeated transfer of the values of a GenMap subtree
+ *  from and to contiguous arrays.
+ *
+ * The plan resolves the entries at or below a path once and keeps pointers to
+ * their values, such that gather() and scatter() are a plain loop over
+ * an array of pointers:
+ * ```
+ * GenMapGatherPlan<double> plan(map, "grid/weights");
+ * std::vector<double> weights(plan.size());
+ * for (...) {
+ *   plan.gather(weights.data(), weights.size());
+ *   kernel(weights);
+ * }
+ * ```
+ * The plan is only valid as long as no entries of the map are inserted,
+ * replaced or erased. If such a modification is detected, the plan is
+ * rebuilt automatically on the next use, such that it always transfers
+ * the values of the entries which are currently in the map.
+ *
+ * All entries of the subtree need to have type T. A plan for ``const T``
+ * can be made from a const GenMap, but only gathers.
+ */
+template <typename T>
+class GenMapGatherPlan {
+ public:
+  /** The type of the values without const */
+  typedef typename std::remove_const<T>::type value_type;
+
+  /** The GenMap a plan can be made for (const only if T is const) */
+  typedef typename std::conditional<std::is_const<T>::value, const GenMap, GenMap>::type
+        genmap_type;
+
+  /** Make a plan for the entries at or below ``path`` in ``map``.
+   *
+   * The plan refers to the data of ``map``, i.e. scatter() modifies the
+   * values stored in ``map``. */
+  GenMapGatherPlan(genmap_type& map, const std::string& path)
+        : m_map{map, path}, m_ptrs{}, m_generation{0}, m_modification_count{0} {}
+
+  /** The number of entries in the subtree, i.e. the array size needed
+   *  by gather() and scatter() */
+  size_t size() const {
+    update_if_needed();
+    return m_ptrs.size();
+  }
+
+  /** Copy the values of the entries to the array ``out`` in the order of the
+   *  keys. ``size`` needs to be equal to size() */
+  void gather(value_type* out, size_t size) const {
+    update_if_needed();
+    assert_throw(size == m_ptrs.size(), ExcSizeMismatch(m_ptrs.size(), size));
+    for (size_t i = 0; i < size; ++i) out[i] = *m_ptrs[i];
+  }
+
+  /** Assign the values from the array ``in`` to the entries in the order of
+   *  the keys. ``size`` needs to be equal to size(). */
+  void scatter(const value_type* in, size_t size) {
+    static_assert(!std::is_const<T>::value, "A plan for const values can only gather.");
+    update_if_needed();
+    assert_throw(size == m_ptrs.size(), ExcSizeMismatch(m_ptrs.size(), size));
+    m_map.m_storage_ptr->invalidate_fingerprints(m_map.m_location);
+    for (size_t i = 0; i < size; ++i) *m_ptrs[i] = in[i];
+  }
+
+  /** Are the pointers to the values of the entries still valid, i.e. will
+   *  the next use of the plan skip rebuilding it. */
+  bool is_current() const {
+    const detail::GenMapStorage& storage = *m_map.m_storage_ptr;
+    return m_generation == storage.generation &&
+           m_modification_count == storage.modification_count;
+  }
+
+ private:
+  /** Collect the pointers to the values again if the map has changed */
+  void update_if_needed() const {
+    if (!is_current()) update();
+  }
+
+  void update() const;
+
+  //! View of the subtree of the map
+  GenMap m_map;
+
+  //! The pointers to the values of the entries in the order of the keys
+  mutable std::vector<T*> m_ptrs;
+
+  //@{
+  //! The state of the storage when m_ptrs was built
+  mutable size_t m_generation;
+  mutable size_t m_modification_count;
+  //@}
+};
+
+//
+// ---------------------------------------------------------
+//
+
+template <typename T>
+void GenMapGatherPlan<T>::update() const {
+  const detail::GenMapStorage& storage = *m_map.m_storage_ptr;
+  GenMap::map_type& map                = m_map.container();
+  const auto last = GenMap::starting_keys_end(map, m_map.m_location);
+
+  m_ptrs.clear();
+  for (auto it = GenMap::starting_keys_begin(map, m_map.m_location); it != last; ++it) {
+    m_ptrs.push_back(&it->second.template get<T>());
+  }
+  m_generation         = storage.generation;
+  m_modification_count = storage.modification_count;
+}
+
+}  // namespace krims
@@ -25,19 +25,31 @@
 
 namespace krims {
 
-template <bool Const>
+/** Iterator over the key-value pairs of a GenMap.
+ *
+ * The second template argument is the type of the iterator over the
+ * underlying container. Its value_type needs to be a pair of the full
+ * key and the GenMapValue (by default the map inside the GenMap is used).
+ */
+template <bool Const,
+          typename Iter = krims::conditional_t<
+                Const, typename detail::GenMapTraits::map_type::const_iterator,
+                typename detail::GenMapTraits::map_type::iterator>>
 class GenMapIterator
       : std::iterator<std::bidirectional_iterator_tag, GenMapAccessor<Const>> {
  public:
   typedef typename detail::GenMapTraits::map_type map_type;
 
   //** The iterator type which is used in this class
-  // to iterate over the map contained in GenMap. */
-  typedef krims::conditional_t<Const, typename map_type::const_iterator,
-                               typename map_type::iterator>
-        iter_type;
-
-  /** Dereference GenMap iterator */
+  // to iterate over the container of the GenMap. */
+  typedef Iter iter_type;
+
+  /** Dereference GenMap iterator
+   *
+   * The accessor is stored inside the iterator and only refers to the
+   * key and value. It is hence only valid until the iterator is changed
+   * or destroyed.
+   */
   GenMapAccessor<Const>& operator*() const { return *operator->(); }
 
   /** Obtain pointer to GenMap accessor */
@@ -46,7 +58,7 @@ class GenMapIterator
   /** Prefix increment to the next key */
   GenMapIterator& operator++() {
     ++m_iter;
-    m_acc_ptr.reset();  // Reset cache
+    m_acc_valid = false;  // Reset cache
     return *this;
   }
 
@@ -60,7 +72,7 @@ class GenMapIterator
   /** Prefix decrement to the next key */
   GenMapIterator& operator--() {
     --m_iter;
-    m_acc_ptr.reset();  // Reset cache
+    m_acc_valid = false;  // Reset cache
     return *this;
   }
 
@@ -78,19 +90,49 @@ class GenMapIterator
   explicit operator iter_type() { return m_iter; }
 
   GenMapIterator(iter_type iter, std::string location)
-        : m_acc_ptr(nullptr), m_iter(iter), m_location(std::move(location)) {}
-
-  GenMapIterator() : m_acc_ptr(nullptr), m_iter(), m_location() {}
+        : m_acc{},
+          m_acc_valid{false},
+          m_key_buffer{},
+          m_iter(iter),
+          m_location(std::move(location)) {}
+
+  GenMapIterator()
+        : m_acc{}, m_acc_valid{false}, m_key_buffer{}, m_iter(), m_location() {}
+
+  //@{
+  /** Copy and assignment (the accessor cache is not copied, since it
+   *  may refer to the key buffer of the other iterator) */
+  GenMapIterator(const GenMapIterator& other)
+        : m_acc{},
+          m_acc_valid{false},
+          m_key_buffer{},
+          m_iter(other.m_iter),
+          m_location(other.m_location) {}
+
+  GenMapIterator& operator=(const GenMapIterator& other) {
+    m_acc_valid = false;
+    m_iter      = other.m_iter;
+    m_location  = other.m_location;
+    return *this;
+  }
+  //@}
 
  private:
   /** Undo the operation of GenMap::make_full_key, i.e. strip off the
-   * first location part and get a relative path to it*/
-  std::string strip_location_prefix(const std::string& key) const;
+   * first location part and get a relative path to it.
+   *
+   * The returned reference either refers to the key itself or to the
+   * key buffer of the iterator, which is overwritten by the next call.*/
+  const std::string& strip_location_prefix(const std::string& key) const;
+
+  /** Cache for the accessor of the current value, which needs to be
+   *  rebuilt before using it unless m_acc_valid is true.*/
+  mutable GenMapAccessor<Const> m_acc;
+  mutable bool m_acc_valid;
 
-  /** Cache for the accessor of the current value.
-   *  A stored nullptr implies that the accessor needs to rebuild
-   *  before using it.*/
-  mutable std::shared_ptr<GenMapAccessor<Const>> m_acc_ptr;
+  /** Buffer for the key relative to m_location, which is reused
+   * for all entries the iterator visits. */
+  mutable std::string m_key_buffer;
 
   /** Iterator to the current key,value pair */
   iter_type m_iter;
@@ -103,31 +145,36 @@ class GenMapIterator
 // -----------------------------------------------
 //
 
-template <bool Const>
-GenMapAccessor<Const>* GenMapIterator<Const>::operator->() const {
-  if (m_acc_ptr == nullptr) {
+template <bool Const, typename Iter>
+GenMapAccessor<Const>* GenMapIterator<Const, Iter>::operator->() const {
+  if (!m_acc_valid) {
     // Generate accessor for current state
-    const std::string key_stripped = strip_location_prefix(m_iter->first);
-    m_acc_ptr = std::make_shared<GenMapAccessor<Const>>(key_stripped, m_iter->second);
+    m_acc.refer_to(strip_location_prefix(m_iter->first), m_iter->second);
+    m_acc_valid = true;
   }
-
-  return m_acc_ptr.get();
+  return &m_acc;
 }
 
-template <bool Const>
-std::string GenMapIterator<Const>::strip_location_prefix(const std::string& key) const {
+template <bool Const, typename Iter>
+const std::string& GenMapIterator<Const, Iter>::strip_location_prefix(
+      const std::string& key) const {
   // The first part needs to be exactly the location:
   assert_internal(key.size() >= m_location.size());
   assert_internal(0 == key.compare(0, m_location.size(), m_location));
 
   if (key.size() <= m_location.size()) {
-    return "/";
+    m_key_buffer.assign(1, '/');
+  } else if (m_location.empty()) {
+    // No location to strip, so the key can be used as it is.
+    assert_internal(key[0] == '/' && key.back() != '/');
+    return key;
   } else {
-    std::string res = key.substr(m_location.size());
-    assert_internal(res[0] == '/' || res.length() == 0);
-    assert_internal(res.back() != '/');
-    return res;
+    // Only reallocates if the key is longer than all previous ones
+    m_key_buffer.assign(key, m_location.size(), std::string::npos);
+    assert_internal(m_key_buffer[0] == '/');
+    assert_internal(m_key_buffer.back() != '/');
   }
+  return m_key_buffer;
 }
 
 }  // namespace krims
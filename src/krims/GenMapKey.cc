@@ -0,0 +1,84 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "GenMapKey.hh"
+#include "ExceptionSystem.hh"
+#include <algorithm>
+
+namespace krims {
+
+GenMapKey::GenMapKey(const detail::GenMapTraits::key_view_type& key)
+      : m_path{}, m_cache_generation{0}, m_cache_location{}, m_cache_iter{} {
+  append_normalised(m_path, key);
+}
+
+void GenMapKey::append_normalised(std::string& res,
+                                  const detail::GenMapTraits::key_view_type& key) {
+  // Size of the part of res we may not touch.
+  const size_t base_size = res.size();
+
+  // start gives the location after the last '/',
+  // ie where the current part of the key path begins and end gives
+  // the location of the current '/', i.e. the past-the-end index
+  // of the current path part.
+  for (size_t start = 0; start < key.size(); ++start) {
+    // Past-the-end of the current path part:
+    const size_t end = std::min(key.find('/', start), key.size());
+    const size_t length = end - start;
+
+    if (length == 0 || (length == 1 && key[start] == '.')) {
+      // Empty path part (i.e. something like '//' is encountered)
+      // or "." path part: Both do nothing.
+    } else if (length == 2 && key[start] == '.' && key[start + 1] == '.') {
+      // If ".." path part, then remove the most recently added path part if any.
+      // Since each part is added with a leading '/', the rfind never
+      // takes us below base_size.
+      if (res.size() > base_size) res.resize(res.rfind('/'));
+    } else {
+      res.push_back('/');
+      res.append(key, start, length);
+    }
+
+    // Update start for next iteration:
+    start = end;
+  }
+
+  assert_internal(res.size() == base_size || res.back() != '/');
+  assert_internal(res.size() == base_size || res[base_size] == '/');
+}
+
+bool GenMapKey::is_normalised(const detail::GenMapTraits::key_view_type& key) {
+  // The leading '/' is optional:
+  const size_t first = (key.size() > 0 && key[0] == '/') ? 1 : 0;
+  if (first == key.size()) return true;  // Root
+
+  // Check each path part, which may be neither empty nor "." nor ".."
+  for (size_t start = first; start <= key.size(); ++start) {
+    const size_t end    = std::min(key.find('/', start), key.size());
+    const size_t length = end - start;
+    if (length == 0) return false;
+    if (key[start] == '.' && (length == 1 || (length == 2 && key[start + 1] == '.'))) {
+      return false;
+    }
+    start = end;
+  }
+  return true;
+}
+
+}  // namespace krims
@@ -0,0 +1,104 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "detail/GenMapTraits.hh"
+#include <string>
+
+namespace krims {
+
+// Forward-declare. Proper declaration in GenMap.hh
+class GenMap;
+
+/** \brief A key into a GenMap, which is normalised only once.
+ *
+ * Whenever a GenMap is accessed using a plain string key, the key
+ * needs to be normalised (i.e. the "." and ".." parts resolved and
+ * duplicate "/" removed), which involves a couple of string operations.
+ * A GenMapKey performs this normalisation once upon construction and can
+ * afterwards be used with all accessor functions of the GenMap in place
+ * of the string key.
+ *
+ * Additionally the GenMapKey remembers the map entry it was
+ * last resolved to. As long as no entries have been removed from
+ * the map in the meantime, a repeated lookup with the same key
+ * in the same map does not search the map again and does not allocate.
+ * ```
+ * const GenMapKey tol_key("solver/tolerance");
+ * for (...) {
+ *   double tol = map.at<double>(tol_key);  // Only first call searches the map
+ * }
+ * ```
+ *
+ * \note The cache is updated from const methods, so a GenMapKey object
+ *       should not be used from multiple threads at the same time.
+ */
+class GenMapKey {
+ public:
+  /** Construct a key from a path, which is normalised by this constructor. */
+  explicit GenMapKey(const detail::GenMapTraits::key_view_type& key);
+
+  /** Return the normalised path of the key.
+   *
+   * The path always starts with a "/" (e.g. "/tree/value") or is empty
+   * if the key refers to the root of a map.
+   */
+  const std::string& path() const { return m_path; }
+
+  /** Append the normalised version of the path ``key`` to ``res``.
+   *
+   * Normalisation follows the UNIX path normalisation, such that
+   * "/bla/../bla/blubber/./foo" is equivalent to "/bla/blubber/foo" and
+   * leading ".." have no effect. The appended string
+   * starts with a "/" unless it is empty (which implies that ``key`` referred
+   * to the root) and never ends with a "/".
+   *
+   * The normalisation never removes characters which have been in ``res``
+   * before the call.
+   */
+  static void append_normalised(std::string& res,
+                                const detail::GenMapTraits::key_view_type& key);
+
+  /** Check whether a path is already normalised.
+   *
+   * This is the case if it is empty, equal to "/" or if
+   * it is equal to its normalised form apart from a possibly missing leading "/",
+   * e.g. "tree/value" or "/tree/value", but not "tree/./value" or "tree/".
+   */
+  static bool is_normalised(const detail::GenMapTraits::key_view_type& key);
+
+ private:
+  friend class GenMap;
+  typedef typename detail::GenMapTraits::map_type map_type;
+
+  //! The normalised path
+  std::string m_path;
+
+  /** The generation of the map storage to which m_cache_iter refers.
+   *  A value of 0 implies that the cache is empty. */
+  mutable size_t m_cache_generation;
+
+  //! The location of the GenMap object m_cache_iter has been obtained for.
+  mutable std::string m_cache_location;
+
+  //! The cached iterator.
+  mutable map_type::iterator m_cache_iter;
+};
+
+}  // namespace krims
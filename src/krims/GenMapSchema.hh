@@ -0,0 +1,224 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "GenMap.hh"
+#include <array>
+#include <tuple>
+#include <vector>
+
+namespace krims {
+
+/** A field of a GenMapSchema, i.e. a key whose value has type T */
+template <typename T>
+struct GenMapField {
+  typedef T value_type;
+
+  //! The key of the field relative to the map the schema is bound to
+  const char* key;
+};
+
+/** Make a GenMapField for a key and the type T */
+template <typename T>
+constexpr GenMapField<T> genmap_field(const char* key) {
+  return GenMapField<T>{key};
+}
+
+/** \brief Handle to the fields of a GenMap, which have been validated
+ *  against a GenMapSchema.
+ *
+ * The handle stores pointers to the values of the fields, such that
+ * ``get<I>()`` is a plain pointer dereference without any key comparison or
+ * type check. Obtain it via GenMapSchema::bind.
+ *
+ * The pointers are only valid as long as no entries of the map are
+ * inserted, replaced or erased. In debug mode this is checked on each
+ * access, otherwise the schema should be bound again after such changes.
+ */
+template <typename... Ts>
+class GenMapSchemaHandle {
+ public:
+  /** Exception raised if a handle is used after the map has been modified */
+  DefExceptionMsg(ExcOutdatedHandle,
+                  "The GenMap has been modified since the schema was bound to it. "
+                  "Bind the schema again to obtain a valid handle.");
+
+  /** The type of the I-th field */
+  template <size_t I>
+  using field_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+  /** The number of fields */
+  static constexpr size_t size() { return sizeof...(Ts); }
+
+  /** Return a reference to the value of the I-th field of the schema */
+  template <size_t I>
+  field_type<I>& get() const {
+    static_assert(I < sizeof...(Ts), "Field index out of range");
+    assert_dbg(is_current(), ExcOutdatedHandle());
+    return *static_cast<field_type<I>*>(m_ptrs[I]);
+  }
+
+  /** Are the pointers to the values still valid, i.e. has no entry of the
+   *  map been inserted, replaced or erased since binding. */
+  bool is_current() const {
+    const detail::GenMapStorage& storage = *m_map.m_storage_ptr;
+    return m_generation == storage.generation &&
+           m_modification_count == storage.modification_count;
+  }
+
+  /** The map (or submap) the schema has been bound to */
+  const GenMap& map() const { return m_map; }
+
+ private:
+  template <typename... Us>
+  friend class GenMapSchema;
+
+  GenMapSchemaHandle(const GenMap& map, const std::array<void*, sizeof...(Ts)>& ptrs)
+        : m_map{map, ""},
+          m_ptrs(ptrs),
+          m_generation{map.m_storage_ptr->generation},
+          m_modification_count{map.m_storage_ptr->modification_count} {}
+
+  //! View of the map, which keeps the values alive
+  GenMap m_map;
+
+  //! The pointers to the values of the fields
+  std::array<void*, sizeof...(Ts)> m_ptrs;
+
+  //@{
+  //! The state of the storage when the pointers were obtained
+  size_t m_generation;
+  size_t m_modification_count;
+  //@}
+};
+
+/** \brief A set of keys known at compile time together with the types of
+ *  their values.
+ *
+ * The schema is validated against a GenMap once by bind(), which returns a
+ * GenMapSchemaHandle with O(1) access to the values of the fields:
+ * ```
+ * constexpr auto solver_schema = make_genmap_schema(
+ *       genmap_field<double>("tolerance"), genmap_field<int>("max_iter"));
+ *
+ * auto solver = solver_schema.bind(map.submap("solver"));
+ * for (...) {
+ *   if (residual < solver.get<0>()) break;
+ * }
+ * ```
+ * If binding is done via a const GenMap, all fields are const.
+ * Lazily computed values are evaluated when the schema is bound.
+ */
+template <typename... Ts>
+class GenMapSchema {
+ public:
+  /** Exception raised if the map does not match the schema */
+  DefException1(ExcSchemaMismatch, std::string,
+                << "The GenMap does not match the schema:" << arg1);
+
+  /** Construct a schema from its fields */
+  constexpr explicit GenMapSchema(GenMapField<Ts>... fields) : m_keys{{fields.key...}} {}
+
+  /** The number of fields */
+  static constexpr size_t size() { return sizeof...(Ts); }
+
+  /** The key of the i-th field */
+  constexpr const char* key(size_t i) const { return m_keys[i]; }
+
+  /** Return the list of all keys which are missing from the map or
+   *  have a value of the wrong type (empty if the map matches the schema) */
+  std::vector<std::string> mismatches(const GenMap& map) const {
+    std::vector<std::string> errors;
+    resolve_all(map, errors);
+    return errors;
+  }
+
+  /** Validate the map against the schema and return a handle to the fields.
+   *
+   * If any key is missing or has a value of the wrong type an
+   * ExcSchemaMismatch listing all such keys is thrown. */
+  GenMapSchemaHandle<Ts...> bind(GenMap& map) const {
+    return GenMapSchemaHandle<Ts...>(map, resolve_or_throw(map));
+  }
+
+  /** Validate the map against the schema and return a handle to the
+   *  fields, which only allows read access. See the non-const version. */
+  GenMapSchemaHandle<const Ts...> bind(const GenMap& map) const {
+    return GenMapSchemaHandle<const Ts...>(map, resolve_or_throw(map));
+  }
+
+ private:
+  typedef std::array<void*, sizeof...(Ts)> ptrs_type;
+
+  /** Find the values of all fields. For those which do not match, an error
+   *  is appended to ``errors`` and a nullptr is returned. */
+  ptrs_type resolve_all(const GenMap& map, std::vector<std::string>& errors) const {
+    // The elements of a braced initialiser list are evaluated in order.
+    size_t i = 0;
+    return ptrs_type{{resolve<Ts>(map, m_keys[i++], errors)...}};
+  }
+
+  ptrs_type resolve_or_throw(const GenMap& map) const {
+    std::vector<std::string> errors;
+    ptrs_type ptrs = resolve_all(map, errors);
+
+    std::string message;
+    for (const std::string& error : errors) message += "\n  - " + error;
+    assert_throw(errors.empty(), ExcSchemaMismatch(message));
+    return ptrs;
+  }
+
+  template <typename T>
+  static void* resolve(const GenMap& map, const char* key,
+                       std::vector<std::string>& errors);
+
+  //! The keys of the fields
+  std::array<const char*, sizeof...(Ts)> m_keys;
+};
+
+/** Make a GenMapSchema from a list of fields */
+template <typename... Ts>
+constexpr GenMapSchema<Ts...> make_genmap_schema(GenMapField<Ts>... fields) {
+  return GenMapSchema<Ts...>(fields...);
+}
+
+//
+// ---------------------------------------------------------
+//
+
+template <typename... Ts>
+template <typename T>
+void* GenMapSchema<Ts...>::resolve(const GenMap& map, const char* key,
+                                   std::vector<std::string>& errors) {
+  auto itkey = map.find_entry(key);
+  if (itkey == std::end(map.container())) {
+    errors.push_back("Key '" + map.make_full_key(key) + "' is missing.");
+    return nullptr;
+  }
+
+  detail::GenMapValue& value = itkey->second;
+  if (!value.template holds<T>()) {
+    errors.push_back("Key '" + itkey->first + "' has type '" + value.type_name() +
+                     "', but type '" + real_typename<T>() + "' is required.");
+    return nullptr;
+  }
+  return &value.template get<typename std::remove_const<T>::type>();
+}
+
+}  // namespace krims
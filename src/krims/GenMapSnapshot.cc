@@ -0,0 +1,403 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "GenMapSnapshot.hh"
+#include "DataFiles/MappedFile.hh"
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef KRIMS_HAVE_POSIX_SHM
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace krims {
+
+namespace {
+//
+// File layout
+//
+//! The version of the snapshot format written by write_genmap_snapshot
+const uint32_t snapshot_version = 1;
+
+//! Marker to detect a different byte order of the reading system
+const uint32_t snapshot_byte_order = 0x01020304;
+
+//! Alignment of the data section in the file
+const uint64_t snapshot_page_size = 4096;
+
+//! Alignment of each value inside the data section
+const uint64_t snapshot_value_alignment = 16;
+
+/** The header at the beginning of a snapshot file.
+ *  All offsets are in bytes from the beginning of the file. */
+struct SnapshotHeader {
+  char magic[8];            //!< "KRIMSGM" followed by a '\0'
+  uint32_t version;         //!< The format version (snapshot_version)
+  uint32_t byte_order;      //!< snapshot_byte_order as written by the system
+  uint64_t n_entries;       //!< Number of entries in the entry table
+  uint64_t entries_offset;  //!< Offset of the entry table
+  uint64_t keys_offset;     //!< Offset of the concatenated keys
+  uint64_t data_offset;     //!< Offset of the data section (page-aligned)
+  uint64_t file_size;       //!< Total size of the file
+  uint64_t reserved;        //!< Unused, zero
+};
+static_assert(sizeof(SnapshotHeader) == 64, "Unexpected padding in SnapshotHeader");
+const char snapshot_magic[8] = {'K', 'R', 'I', 'M', 'S', 'G', 'M', '\0'};
+
+//! The kind of value stored in an entry
+enum class ValueKind : uint32_t { SCALAR = 0, VECTOR = 1, STRING = 2 };
+
+/** An entry of the entry table. The entries are stored in the order of
+ *  the keys inside the GenMap. */
+struct SnapshotEntry {
+  uint64_t key_offset;   //!< Offset of the key relative to keys_offset
+  uint64_t key_size;     //!< Number of characters of the key
+  uint64_t data_offset;  //!< Offset of the value data (16-byte aligned)
+  uint64_t data_size;    //!< Number of bytes of the value data
+  uint32_t kind;         //!< The ValueKind
+  uint32_t type_index;   //!< Index of the element type into snapshot_types
+};
+static_assert(sizeof(SnapshotEntry) == 40, "Unexpected padding in SnapshotEntry");
+
+//
+// Supported types
+//
+template <typename... Ts>
+struct TypeList {};
+
+/** The types which can be stored as scalars or (except bool) as elements of
+ *  vectors. The position in the list is the type_index stored in the file,
+ *  so new types may only be appended. */
+typedef TypeList<bool, char, signed char, unsigned char, short, unsigned short, int,
+                 unsigned int, long, unsigned long, long long, unsigned long long, float,
+                 double, long double, std::complex<float>, std::complex<double>,
+                 std::complex<long double>>
+      snapshot_types;
+
+//! The raw data of a value to be written
+struct ValueData {
+  ValueKind kind;
+  uint32_t type_index;
+  const char* data;
+  size_t size;
+};
+
+template <typename T>
+bool describe_vector(const detail::GenMapValue& value, uint32_t index, ValueData& out) {
+  if (!value.holds<std::vector<T>>() || value.get_ptr<std::vector<T>>() == nullptr) {
+    return false;
+  }
+  const std::vector<T>& v = value.get<std::vector<T>>();
+  out = {ValueKind::VECTOR, index, reinterpret_cast<const char*>(v.data()),
+         v.size() * sizeof(T)};
+  return true;
+}
+
+// std::vector<bool> does not store its elements contiguously.
+template <>
+bool describe_vector<bool>(const detail::GenMapValue&, uint32_t, ValueData&) {
+  return false;
+}
+
+bool describe_value(const detail::GenMapValue&, TypeList<>, uint32_t, ValueData&) {
+  return false;
+}
+
+/** Find the type of the value and fill out with the data to write.
+ *  Returns false if the type is not supported. */
+template <typename T, typename... Ts>
+bool describe_value(const detail::GenMapValue& value, TypeList<T, Ts...>, uint32_t index,
+                    ValueData& out) {
+  if (value.holds<T>()) {
+    if (value.get_ptr<T>() == nullptr) return false;
+    out = {ValueKind::SCALAR, index, reinterpret_cast<const char*>(&value.get<T>()),
+           sizeof(T)};
+    return true;
+  }
+  if (describe_vector<T>(value, index, out)) return true;
+  return describe_value(value, TypeList<Ts...>{}, index + 1, out);
+}
+
+bool describe_value(const detail::GenMapValue& value, ValueData& out) {
+  if (value.holds<std::string>()) {
+    if (value.get_ptr<std::string>() == nullptr) return false;
+    const std::string& s = value.get<std::string>();
+    out                  = {ValueKind::STRING, 0, s.data(), s.size()};
+    return true;
+  }
+  return describe_value(value, snapshot_types{}, 0, out);
+}
+
+uint64_t align_up(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+//
+// Reading
+//
+template <typename T>
+detail::GenMapValue make_vector(const char* data, size_t size) {
+  const T* begin = reinterpret_cast<const T*>(data);
+  return detail::GenMapValue(std::vector<T>(begin, begin + size / sizeof(T)));
+}
+
+template <>
+detail::GenMapValue make_vector<bool>(const char*, size_t) {
+  assert_internal(false);
+  return detail::GenMapValue{};
+}
+
+detail::GenMapValue make_value(const SnapshotEntry&, const std::shared_ptr<char>&,
+                               TypeList<>, uint32_t, const std::string& file) {
+  assert_throw(false, ExcInvalidBinaryFile(file, "Unknown type index of a value."));
+  return detail::GenMapValue{};
+}
+
+/** Build the value of an entry. Scalars refer into the buffer, which is kept
+ *  alive by the value (using the aliasing constructor of shared_ptr) */
+template <typename T, typename... Ts>
+detail::GenMapValue make_value(const SnapshotEntry& entry,
+                               const std::shared_ptr<char>& buffer, TypeList<T, Ts...>,
+                               uint32_t index, const std::string& file) {
+  if (entry.type_index != index) {
+    return make_value(entry, buffer, TypeList<Ts...>{}, index + 1, file);
+  }
+
+  char* data = buffer.get() + entry.data_offset;
+  if (entry.kind == static_cast<uint32_t>(ValueKind::SCALAR)) {
+    assert_throw(entry.data_size == sizeof(T),
+                 ExcInvalidBinaryFile(file, "Size of a scalar value does not agree with "
+                                            "the size of its type on this system."));
+    return detail::GenMapValue(std::shared_ptr<T>(buffer, reinterpret_cast<T*>(data)));
+  } else {
+    const bool is_bool = std::is_same<T, bool>::value;
+    assert_throw(!is_bool && entry.data_size % sizeof(T) == 0,
+                 ExcInvalidBinaryFile(file, "Size of a vector value is not a multiple "
+                                            "of the size of its element type."));
+    return make_vector<T>(data, entry.data_size);
+  }
+}
+
+/** The layout of the snapshot of a map, i.e. everything needed to write it */
+struct SnapshotLayout {
+  SnapshotHeader header;
+  std::vector<SnapshotEntry> entries;
+  std::vector<ValueData> values;  //!< Pointing to the data of the map
+  std::string keys;               //!< The concatenated keys
+};
+
+/** Compute the layout of the snapshot of all entries of a map */
+SnapshotLayout make_layout(const GenMap& map) {
+  // Collect keys and values and compute the layout
+  SnapshotLayout layout;
+  for (auto it = map.cbegin(); it != map.cend(); ++it) {
+    ValueData value;
+    const detail::GenMapValue& raw = it->value_raw();
+    const bool supported           = !raw.empty() && describe_value(raw, value);
+    assert_throw(supported,
+                 ExcUnsupportedSnapshotValue(it->key(), it->type_name()));
+
+    // The root of the map is stored as the empty key, such that
+    // the stored keys are exactly the keys inside the GenMap.
+    const std::string& key = it->key();
+    const size_t key_size  = key == "/" ? 0 : key.size();
+    layout.entries.push_back({layout.keys.size(), key_size, 0, value.size,
+                              static_cast<uint32_t>(value.kind), value.type_index});
+    layout.keys.append(key, 0, key_size);
+    layout.values.push_back(value);
+  }
+
+  SnapshotHeader& header = layout.header;
+  const size_t n_entries = layout.entries.size();
+  std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+  header.version        = snapshot_version;
+  header.byte_order     = snapshot_byte_order;
+  header.n_entries      = n_entries;
+  header.entries_offset = sizeof(SnapshotHeader);
+  header.keys_offset    = header.entries_offset + n_entries * sizeof(SnapshotEntry);
+  header.reserved       = 0;
+  header.data_offset =
+        align_up(header.keys_offset + layout.keys.size(), snapshot_page_size);
+
+  uint64_t offset = header.data_offset;
+  for (SnapshotEntry& entry : layout.entries) {
+    entry.data_offset = offset;
+    offset            = align_up(offset + entry.data_size, snapshot_value_alignment);
+  }
+  header.file_size = offset;
+  return layout;
+}
+
+/** Write a snapshot by passing its bytes piece by piece to ``write``,
+ *  which is called as ``write(const char* data, size_t size)`` */
+template <typename Write>
+void write_layout(const SnapshotLayout& layout, Write&& write) {
+  const SnapshotHeader& header = layout.header;
+  write(reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader));
+  write(reinterpret_cast<const char*>(layout.entries.data()),
+        layout.entries.size() * sizeof(SnapshotEntry));
+  write(layout.keys.data(), layout.keys.size());
+
+  const std::vector<char> padding(snapshot_page_size, '\0');
+  uint64_t position = header.keys_offset + layout.keys.size();
+  for (size_t i = 0; i < layout.entries.size(); ++i) {
+    write(padding.data(), layout.entries[i].data_offset - position);
+    write(layout.values[i].data, layout.values[i].size);
+    position = layout.entries[i].data_offset + layout.values[i].size;
+  }
+  write(padding.data(), header.file_size - position);
+}
+
+/** Parse a snapshot file, which has been loaded into the buffer, into a map */
+detail::GenMapTraits::map_type parse_snapshot(const std::shared_ptr<char>& buffer,
+                                              uint64_t size, const std::string& file) {
+  assert_throw(size >= sizeof(SnapshotHeader),
+               ExcInvalidBinaryFile(file, "File is too small for a GenMap snapshot."));
+  SnapshotHeader header;
+  std::memcpy(&header, buffer.get(), sizeof(SnapshotHeader));
+
+  assert_throw(std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) == 0,
+               ExcInvalidBinaryFile(file, "File is not a GenMap snapshot."));
+  assert_throw(header.version == snapshot_version,
+               ExcInvalidBinaryFile(file, "Unsupported snapshot version " +
+                                                std::to_string(header.version) + "."));
+  assert_throw(header.byte_order == snapshot_byte_order,
+               ExcInvalidBinaryFile(file, "Snapshot has been written on a system with "
+                                          "different byte order."));
+  assert_throw(header.file_size == size && header.entries_offset <= size &&
+                     header.n_entries <= (size - header.entries_offset) /
+                                               sizeof(SnapshotEntry) &&
+                     header.keys_offset <= size && header.data_offset <= size &&
+                     header.data_offset % snapshot_value_alignment == 0,
+               ExcInvalidBinaryFile(file, "Snapshot header is inconsistent."));
+
+  detail::GenMapTraits::map_type map;
+  const char* entries = buffer.get() + header.entries_offset;
+  const char* keys    = buffer.get() + header.keys_offset;
+  for (uint64_t i = 0; i < header.n_entries; ++i) {
+    SnapshotEntry entry;
+    std::memcpy(&entry, entries + i * sizeof(SnapshotEntry), sizeof(SnapshotEntry));
+    assert_throw(entry.key_offset <= size - header.keys_offset &&
+                       entry.key_size <= size - header.keys_offset - entry.key_offset &&
+                       entry.data_offset <= size &&
+                       entry.data_size <= size - entry.data_offset &&
+                       entry.data_offset % snapshot_value_alignment == 0,
+                 ExcInvalidBinaryFile(file, "Snapshot entry " + std::to_string(i) +
+                                                  " is inconsistent."));
+
+    detail::GenMapValue value;
+    if (entry.kind == static_cast<uint32_t>(ValueKind::STRING)) {
+      value = std::string(buffer.get() + entry.data_offset, entry.data_size);
+    } else {
+      assert_throw(entry.kind == static_cast<uint32_t>(ValueKind::SCALAR) ||
+                         entry.kind == static_cast<uint32_t>(ValueKind::VECTOR),
+                   ExcInvalidBinaryFile(file, "Unknown kind of value."));
+      value = make_value(entry, buffer, snapshot_types{}, 0, file);
+    }
+
+    // The keys are stored in the order of the map, so insert at the end.
+    map.emplace_hint(std::end(map), std::string(keys + entry.key_offset, entry.key_size),
+                     std::move(value));
+  }
+  assert_throw(map.size() == header.n_entries,
+               ExcInvalidBinaryFile(file, "Snapshot contains duplicate keys."));
+  return map;
+}
+}  // namespace
+
+void write_genmap_snapshot(const GenMap& map, const std::string& file) {
+  const SnapshotLayout layout = make_layout(map);
+
+  std::ofstream out(file, std::ios::binary);
+  assert_throw(out, ExcFileNotOpen(file.c_str()));
+  write_layout(layout, [&out](const char* data, size_t size) {
+    out.write(data, static_cast<std::streamsize>(size));
+  });
+  assert_throw(out, ExcIO());
+}
+
+GenMap read_genmap_snapshot(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  assert_throw(in, ExcFileNotOpen(file.c_str()));
+  in.seekg(0, std::ios::end);
+  const uint64_t size = static_cast<uint64_t>(in.tellg());
+  in.seekg(0, std::ios::beg);
+
+  // Memory from new[] is suitably aligned for all scalar types, so are
+  // the values in the buffer since their offsets are multiples of 16.
+  std::shared_ptr<char> buffer(new char[size], std::default_delete<char[]>());
+  in.read(buffer.get(), static_cast<std::streamsize>(size));
+  assert_throw(in, ExcIO());
+
+  GenMap res;
+  res.container_for_writing() = parse_snapshot(buffer, size, file);
+  return res;
+}
+
+GenMap mmap_genmap_snapshot(const std::string& file) {
+  const MappedFile mapped(file);
+  GenMap res;
+  res.container_for_writing() = parse_snapshot(mapped.data_ptr(), mapped.size(), file);
+  return res;
+}
+
+#ifdef KRIMS_HAVE_POSIX_SHM
+void share_genmap_snapshot(const GenMap& map, const std::string& name) {
+  const SnapshotLayout layout = make_layout(map);
+  const size_t size           = layout.header.file_size;
+
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  assert_throw(fd >= 0, ExcFileNotOpen(name.c_str()));
+  void* ptr = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);  // The mapping stays valid
+  if (ptr == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    assert_throw(false, ExcIO());
+  }
+
+  char* pos = static_cast<char*>(ptr);
+  write_layout(layout, [&pos](const char* data, size_t n) {
+    if (n == 0) return;
+    std::memcpy(pos, data, n);
+    pos += n;
+  });
+  munmap(ptr, size);
+}
+
+GenMap attach_genmap_snapshot(const std::string& name) {
+  const MappedFile mapped = MappedFile::shared_memory(name);
+  GenMap res;
+  res.container_for_writing() = parse_snapshot(mapped.data_ptr(), mapped.size(), name);
+  return res;
+}
+
+bool unlink_genmap_snapshot(const std::string& name) {
+  return shm_unlink(name.c_str()) == 0;
+}
+#endif
+
+}  // namespace krims
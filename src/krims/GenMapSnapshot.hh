@@ -0,0 +1,113 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "DataFiles/read_binary.hh"
+#include "GenMap.hh"
+
+namespace krims {
+
+/** Exception thrown if a GenMap entry cannot be stored in a snapshot */
+DefException2(ExcUnsupportedSnapshotValue, std::string, std::string,
+              << "The value of type " << arg2 << " at key " << arg1
+              << " cannot be stored in a GenMap snapshot.");
+
+/** \brief Write all entries of a GenMap (or a submap) into a binary snapshot file.
+ *
+ * Supported are entries holding arithmetic values, ``std::complex`` numbers,
+ * ``std::string`` and ``std::vector`` of arithmetic or complex values.
+ * For other entries an ExcUnsupportedSnapshotValue is thrown. This includes
+ * enums: Their type is not known when the file is read back, so store them
+ * as their underlying integer type instead.
+ *
+ * The file consists of a versioned header, a table of the entries and the
+ * keys, followed by the data of the values. The data section starts at a page
+ * boundary and each value is aligned to 16 bytes, such that the values can
+ * be used in place once the file is mapped into memory
+ * (see mmap_genmap_snapshot).
+ *
+ * \note As for write_binary the data is written in the byte order and with
+ * the type sizes of the system. Reading a snapshot on a system where these
+ * differ is detected and results in an ExcInvalidBinaryFile.
+ */
+void write_genmap_snapshot(const GenMap& map, const std::string& file);
+
+/** \brief Read a GenMap from a snapshot file written by write_genmap_snapshot.
+ *
+ * The file is read into memory in one go. The scalar values of the returned
+ * map refer directly to this memory, only strings and vectors are copied
+ * out of it. Throws ExcInvalidBinaryFile if the file is not a valid snapshot.
+ */
+GenMap read_genmap_snapshot(const std::string& file);
+
+/** \brief Load a GenMap from a snapshot file by mapping the file into memory.
+ *
+ * Like read_genmap_snapshot, but the file is not read at all. Instead it is
+ * mapped (privately) into memory, such that the scalar values of the
+ * returned map refer directly to the pages of the file. Hence only the pages
+ * which are accessed are loaded from disk. Modifications of the values
+ * via the map are possible, but never written back to the file.
+ *
+ * The mapping is released once the map and all copies of its values are
+ * destroyed. If memory-mapping is not supported by the system
+ * (KRIMS_HAVE_POSIX_MMAP is not set) this is identical to read_genmap_snapshot.
+ */
+GenMap mmap_genmap_snapshot(const std::string& file);
+
+#ifdef KRIMS_HAVE_POSIX_SHM
+/** \brief Write a snapshot of a GenMap into a new POSIX shared memory object.
+ *
+ * Meant for many processes on the same node which need the same map (e.g.
+ * the ranks of an MPI job): One process shares the map under a ``name``
+ * of the form "/some_name" (see ``shm_open``), the others obtain it via
+ * attach_genmap_snapshot:
+ * ```
+ * if (rank == 0) share_genmap_snapshot(params, "/job_params");
+ * MPI_Barrier(node_comm);
+ * GenMap params = attach_genmap_snapshot("/job_params");
+ * MPI_Barrier(node_comm);
+ * if (rank == 0) unlink_genmap_snapshot("/job_params");
+ * ```
+ * The requirements for the entries are the same as for write_genmap_snapshot.
+ * Throws ExcFileNotOpen if the object already exists or cannot be created.
+ * The object exists until it is removed by unlink_genmap_snapshot.
+ *
+ * \note Other processes may only attach after this function has returned.
+ */
+void share_genmap_snapshot(const GenMap& map, const std::string& name);
+
+/** \brief Load a GenMap from a snapshot in a POSIX shared memory object
+ *  written by share_genmap_snapshot.
+ *
+ * Like mmap_genmap_snapshot the shared memory is mapped privately, such
+ * that the scalar values of the returned map refer directly to the shared
+ * pages. These are only copied for the process modifying them, so all
+ * processes attached to the object share the same physical memory. Strings and
+ * vectors as well as the keys are copied into the memory of the process.
+ * Lookups need no locking, since no process writes to the shared pages.
+ */
+GenMap attach_genmap_snapshot(const std::string& name);
+
+/** Remove the name of a shared memory object created by share_genmap_snapshot.
+ *  Maps which are attached to it stay valid. Returns false if there is no
+ *  such object. */
+bool unlink_genmap_snapshot(const std::string& name);
+#endif
+
+}  // namespace krims
@@ -0,0 +1,128 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "GenMapStatistics.hh"
+#include <algorithm>
+#include <iomanip>
+
+#ifdef KRIMS_GENMAP_STATISTICS
+#include <mutex>
+#include <unordered_map>
+#endif
+
+namespace krims {
+
+#ifdef KRIMS_GENMAP_STATISTICS
+namespace {
+/** The statistics of all keys, protected by a mutex */
+struct StatisticsTable {
+  std::mutex mutex;
+  std::unordered_map<std::string, GenMapKeyStatistics> by_key;
+};
+
+StatisticsTable& statistics_table() {
+  static StatisticsTable table;
+  return table;
+}
+}  // namespace
+
+namespace detail {
+void record_genmap_lookup(const std::string& key, bool found, bool cached,
+                          double normalise_ns, double search_ns) {
+  StatisticsTable& table = statistics_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto it = table.by_key.find(key);
+  if (it == std::end(table.by_key)) {
+    it = table.by_key.emplace(key, GenMapKeyStatistics{key, 0, 0, 0, 0., 0.}).first;
+  }
+
+  GenMapKeyStatistics& stats = it->second;
+  stats.n_lookups += 1;
+  stats.n_misses += found ? 0 : 1;
+  stats.n_cached += cached ? 1 : 0;
+  stats.normalise_ns += normalise_ns;
+  stats.search_ns += search_ns;
+}
+}  // namespace detail
+
+std::vector<GenMapKeyStatistics> genmap_statistics() {
+  std::vector<GenMapKeyStatistics> res;
+  {
+    StatisticsTable& table = statistics_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    res.reserve(table.by_key.size());
+    for (const auto& kv : table.by_key) res.push_back(kv.second);
+  }
+
+  std::sort(std::begin(res), std::end(res),
+            [](const GenMapKeyStatistics& lhs, const GenMapKeyStatistics& rhs) {
+              return lhs.total_ns() > rhs.total_ns();
+            });
+  return res;
+}
+
+void reset_genmap_statistics() {
+  StatisticsTable& table = statistics_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  table.by_key.clear();
+}
+#else
+std::vector<GenMapKeyStatistics> genmap_statistics() { return {}; }
+void reset_genmap_statistics() {}
+#endif
+
+void print_genmap_statistics(std::ostream& out, size_t max_keys) {
+  if (!genmap_statistics_enabled()) {
+    out << "GenMap statistics are not collected (configure krims with "
+           "KRIMS_GENMAP_STATISTICS=ON)."
+        << std::endl;
+    return;
+  }
+
+  const std::vector<GenMapKeyStatistics> stats = genmap_statistics();
+  GenMapKeyStatistics sum{"(all keys)", 0, 0, 0, 0., 0.};
+  for (const GenMapKeyStatistics& s : stats) {
+    sum.n_lookups += s.n_lookups;
+    sum.n_misses += s.n_misses;
+    sum.n_cached += s.n_cached;
+    sum.normalise_ns += s.normalise_ns;
+    sum.search_ns += s.search_ns;
+  }
+
+  const auto print_row = [&out](const GenMapKeyStatistics& s) {
+    out << std::left << std::setw(40) << s.key << std::right << std::setw(10)
+        << s.n_lookups << std::setw(10) << s.n_misses << std::setw(10) << s.n_cached
+        << std::fixed << std::setprecision(1) << std::setw(14) << s.normalise_ns / 1000.
+        << std::setw(14) << s.search_ns / 1000. << std::setw(14) << s.total_ns() / 1000.
+        << std::endl;
+  };
+
+  out << std::left << std::setw(40) << "key" << std::right << std::setw(10) << "lookups"
+      << std::setw(10) << "misses" << std::setw(10) << "cached" << std::setw(14)
+      << "normalise/us" << std::setw(14) << "search/us" << std::setw(14) << "total/us"
+      << std::endl;
+  const size_t n_print = std::min(max_keys, stats.size());
+  std::for_each(std::begin(stats), std::begin(stats) + n_print, print_row);
+  if (n_print < stats.size()) {
+    out << "... (" << stats.size() - n_print << " more keys)" << std::endl;
+  }
+  print_row(sum);
+}
+
+}  // namespace krims
@@ -0,0 +1,133 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "krims/config.hh"
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef KRIMS_GENMAP_STATISTICS
+#include <chrono>
+#endif
+
+namespace krims {
+
+/** Statistics about the lookups of a single key in all GenMaps */
+struct GenMapKeyStatistics {
+  //! The full key
+  std::string key;
+
+  //! The number of lookups of the key
+  size_t n_lookups;
+
+  //! The number of lookups which did not find an entry
+  size_t n_misses;
+
+  //! The number of lookups via a GenMapKey, which were answered from its cache
+  size_t n_cached;
+
+  //! The total time spent normalising the key (in nanoseconds)
+  double normalise_ns;
+
+  //! The total time spent searching the map (in nanoseconds)
+  double search_ns;
+
+  //! The total time spent for all lookups of the key
+  double total_ns() const { return normalise_ns + search_ns; }
+};
+
+/** Are the statistics about GenMap lookups collected, i.e. has krims been
+ *  configured with the cmake option KRIMS_GENMAP_STATISTICS. */
+constexpr bool genmap_statistics_enabled() {
+#ifdef KRIMS_GENMAP_STATISTICS
+  return true;
+#else
+  return false;
+#endif
+}
+
+/** \brief Return the statistics about the lookups in all GenMaps of the process,
+ *  sorted by the total time spent (most expensive key first).
+ *
+ * Lookups are all calls which search an entry by its key, e.g. ``at``,
+ * ``at_ptr``, ``exists`` or ``erase``, whether by string key or by GenMapKey.
+ * The time for each lookup is split into the time for normalising the
+ * key and the time for searching the map.
+ *
+ * Use this to find the keys, whose lookup should be hoisted out of loops or
+ * done via a GenMapKey. The statistics are only collected if krims was
+ * configured with KRIMS_GENMAP_STATISTICS (which slows down all lookups),
+ * else the returned list is empty.
+ */
+std::vector<GenMapKeyStatistics> genmap_statistics();
+
+/** Reset the statistics about GenMap lookups */
+void reset_genmap_statistics();
+
+/** Print a table of the statistics about GenMap lookups for the
+ *  ``max_keys`` most expensive keys to ``out``. */
+void print_genmap_statistics(std::ostream& out, size_t max_keys = 20);
+
+namespace detail {
+#ifdef KRIMS_GENMAP_STATISTICS
+/** Record a lookup of the full key ``key`` */
+void record_genmap_lookup(const std::string& key, bool found, bool cached,
+                          double normalise_ns, double search_ns);
+
+/** \brief Timer for a lookup in a GenMap.
+ *
+ * Constructed at the start of the lookup, normalised() is called once the key
+ * has been normalised and record() once the search is done.
+ */
+class GenMapLookupTimer {
+ public:
+  GenMapLookupTimer() : m_start{clock::now()}, m_normalised{m_start} {}
+
+  void normalised() { m_normalised = clock::now(); }
+
+  /** Record the lookup, where full_key is a functor returning the full key. */
+  template <typename KeyFunctor>
+  void record(bool found, KeyFunctor&& full_key, bool cached = false) {
+    const clock::time_point end = clock::now();
+    typedef std::chrono::duration<double, std::nano> nanoseconds;
+    record_genmap_lookup(full_key(), found, cached,
+                         nanoseconds(m_normalised - m_start).count(),
+                         nanoseconds(end - m_normalised).count());
+  }
+
+ private:
+  typedef std::chrono::steady_clock clock;
+  clock::time_point m_start;
+  clock::time_point m_normalised;
+};
+#else
+/** Timer for a lookup in a GenMap, which does nothing since the statistics
+ *  are not collected. */
+class GenMapLookupTimer {
+ public:
+  void normalised() {}
+
+  template <typename KeyFunctor>
+  void record(bool, KeyFunctor&&, bool = false) {}
+};
+#endif
+}  // namespace detail
+
+}  // namespace krims
@@ -0,0 +1,96 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace krims {
+
+/** \brief Handle for the subscription to changes in a subtree of a GenMap
+ *
+ * Obtained from GenMap::watch. Modifications of the entries in the watched
+ * subtree by ``update``, ``insert_default``, ``erase`` or ``clear`` are
+ * collected by the map and only delivered to the watches at the next call
+ * to GenMap::flush. Then the watch becomes dirty and its callback (if any)
+ * is called once with all keys changed since the previous flush:
+ * ```
+ * GenMapWatch watch = params.watch("solver");
+ * params.update("solver/tolerance", 1e-8);
+ * params.update("solver/maxiter", 100);
+ * params.flush();
+ * if (watch.is_dirty()) {
+ *   setup_solver(params.submap("solver"));
+ *   watch.reset();
+ * }
+ * ```
+ *
+ * Changes to the data stored in the entries (e.g. via a reference obtained
+ * from ``at``) do not count as a modification. The subscription ends once
+ * all copies of the handle have been destroyed or released.
+ */
+class GenMapWatch {
+ public:
+  /** Type of the callback. It is passed the keys of the changed entries relative
+   *  to the watched path. The empty key refers to the watched path itself,
+   *  which is also used if the whole subtree has been modified at once
+   *  (e.g. by erasing or clearing a parent path). */
+  typedef std::function<void(const std::vector<std::string>& changed_keys)> callback_type;
+
+  /** The state shared between the handle and the GenMap being watched */
+  struct State {
+    //! Full key of the watched path in the map
+    std::string full_path;
+
+    //! Callback to call for changes (may be empty)
+    callback_type callback;
+
+    //! Have changes been delivered since the last reset
+    bool dirty;
+  };
+
+  /** Construct a handle which does not watch anything */
+  GenMapWatch() : m_state_ptr{nullptr} {}
+
+  /** Is this handle subscribed to a map */
+  bool is_active() const { return m_state_ptr != nullptr; }
+
+  /** Have changes in the watched subtree been flushed since the
+   *  construction or the last call to reset() */
+  bool is_dirty() const { return m_state_ptr != nullptr && m_state_ptr->dirty; }
+
+  /** Mark the watched subtree as clean */
+  void reset() {
+    if (m_state_ptr != nullptr) m_state_ptr->dirty = false;
+  }
+
+  /** Stop watching (if this is the last handle referring to the subscription) */
+  void release() { m_state_ptr.reset(); }
+
+ private:
+  friend class GenMap;
+  explicit GenMapWatch(std::shared_ptr<State> state_ptr)
+        : m_state_ptr{std::move(state_ptr)} {}
+
+  std::shared_ptr<State> m_state_ptr;
+};
+
+}  // namespace krims
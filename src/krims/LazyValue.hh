@@ -0,0 +1,75 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "TypeUtils/UsingLibrary.hh"
+#include <functional>
+#include <utility>
+
+namespace krims {
+
+/** \brief A value of type T, which is only computed when it is first needed.
+ *
+ * Stores a factory returning the value. If a LazyValue is passed to
+ * GenMap::update, the factory is stored inside the map and called exactly
+ * once upon the first access to the value via ``at`` or ``at_ptr``
+ * (even if the map is accessed from many threads at the same time).
+ * Afterwards the computed value is returned directly.
+ * ```
+ * GenMap map;
+ * map.update("grid", make_lazy([] { return Grid(100); }));
+ * map.is_evaluated("grid");             // false, no Grid constructed yet
+ * const Grid& grid = map.at<Grid>("grid");  // Constructs the Grid
+ * ```
+ * If the factory throws, the exception is passed on to the caller and
+ * the factory is called again on the next access.
+ */
+template <typename T>
+class LazyValue {
+ public:
+  typedef T value_type;
+
+  /** Construct from a factory returning the value */
+  explicit LazyValue(std::function<T()> factory) : m_factory{std::move(factory)} {}
+
+  /** Return the factory */
+  const std::function<T()>& factory() const { return m_factory; }
+
+ private:
+  std::function<T()> m_factory;
+};
+
+/** Make a LazyValue from a factory functor, which is called without arguments.
+ *  The type of the value is the return type of the factory. */
+template <typename Factory>
+LazyValue<decay_t<decltype(std::declval<Factory&>()())>> make_lazy(Factory&& factory) {
+  return LazyValue<decay_t<decltype(std::declval<Factory&>()())>>(
+        std::forward<Factory>(factory));
+}
+
+//@{
+/** Is the type T a LazyValue */
+template <typename T>
+struct IsLazyValue : public std::false_type {};
+
+template <typename T>
+struct IsLazyValue<LazyValue<T>> : public std::true_type {};
+//@}
+
+}  // namespace krims
@@ -24,6 +24,9 @@
 #include <krims/TypeUtils/EnableIfLibrary.hh>
 #include <krims/TypeUtils/IsCheaplyCopyable.hh>
 #include <krims/TypeUtils/IsSubscribable.hh>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <type_traits>
 
 namespace krims {
@@ -102,11 +105,36 @@ class RCPWrapper {
   std::shared_ptr<T> m_shared_ptr;
 };
 
+namespace detail {
+/** Control block of an RCPWrapper, which owns its object.
+ *
+ * Keeps the shared pointer the wrapper has been constructed from alive as
+ * long as any copy of the wrapper exists. */
+struct RCPOwnerBlock {
+  //! Number of RCPWrappers referring to this block
+  std::atomic<size_t> n_refs;
+
+  //! The owning pointer
+  std::shared_ptr<const void> owner;
+};
+}  // namespace detail
+
 /** \brief Wrapper class taking either a std::shared_ptr or a subscription
  * pointer.
  *
  * For more details see the primary template. This partial specialisation
  * may take both a std::shared_ptr as well as a SubscriptionPointer<T>.
+ *
+ * The wrapper consists of the pointer to the object, which is returned by
+ * get() without any branching, and a tagged pointer to a control block.
+ * If the lowest bit of the tagged pointer is set, the wrapper references the
+ * object via a subscription and the remaining bits point to the slot of the
+ * subscription at the object (DEBUG mode) or are zero (RELEASE mode). Otherwise the
+ * wrapper owns the object and the tagged pointer points to a
+ * detail::RCPOwnerBlock (or is zero if the wrapper is empty).
+ *
+ * Constructing from a non-empty shared pointer allocates the control block
+ * once, copying just increments its reference count.
  **/
 template <typename T>
 class RCPWrapper<T, typename krims::enable_if_t<IsSubscribable<T>::value &&
@@ -120,48 +148,54 @@ class RCPWrapper<T, typename krims::enable_if_t<IsSubscribable<T>::value &&
   /** \name Constructors */
   ///@{
   /** Default constructor: Construct RCPWrapper containing nullptr */
-  RCPWrapper()
-        : m_contains_shared_ptr{false}, m_subscr_ptr{nullptr}, m_shared_ptr{nullptr} {}
+  RCPWrapper() : m_ptr{nullptr}, m_tagged_ctrl{subscribed_bit} {}
 
   /** Construct RCPWrapper from subscription pointer */
   explicit RCPWrapper(const SubscriptionPointer<T> ptr)
-        : m_contains_shared_ptr{false},
-          m_subscr_ptr{std::move(ptr)},
-          m_shared_ptr{nullptr} {}
+        : m_ptr{ptr.get()}, m_tagged_ctrl{subscribed_bit} {
+    acquire(&ptr.subscriber_id());
+  }
 
   /** Construct RCPWrapper from shared pointer */
-  explicit RCPWrapper(const std::shared_ptr<T> ptr)
-        : m_contains_shared_ptr{true},
-          m_subscr_ptr{"RCPWrapper"},
-          m_shared_ptr{std::move(ptr)} {}
+  explicit RCPWrapper(const std::shared_ptr<T> ptr) : m_ptr{ptr.get()}, m_tagged_ctrl{0} {
+    if (ptr != nullptr) {
+      m_tagged_ctrl = reinterpret_cast<uintptr_t>(
+            new detail::RCPOwnerBlock{{1}, std::shared_ptr<const void>(std::move(ptr))});
+    }
+  }
 
   /** Implicitly convert from a different inner type */
   template <typename U, typename = enable_if_t<std::is_convertible<U*, T*>::value>>
-  RCPWrapper(const RCPWrapper<U>& pw)
-        : m_contains_shared_ptr{pw.m_contains_shared_ptr},
-          m_subscr_ptr{pw.m_subscr_ptr},
-          m_shared_ptr{pw.m_shared_ptr} {}
+  RCPWrapper(const RCPWrapper<U>& pw) : m_ptr{pw.m_ptr}, m_tagged_ctrl{pw.m_tagged_ctrl} {
+    acquire(pw.subscriber_id());
+  }
 
   /** Copy constructor */
-  RCPWrapper(const RCPWrapper& pw)
-        : m_contains_shared_ptr{pw.m_contains_shared_ptr},
-          m_subscr_ptr{pw.m_subscr_ptr},
-          m_shared_ptr{pw.m_shared_ptr} {}
+  RCPWrapper(const RCPWrapper& pw) : m_ptr{pw.m_ptr}, m_tagged_ctrl{pw.m_tagged_ctrl} {
+    acquire(pw.subscriber_id());
+  }
 
-  RCPWrapper(RCPWrapper&&) = default;
-  RCPWrapper& operator=(RCPWrapper&&) = default;
-  RCPWrapper& operator=(const RCPWrapper&) = default;
-  ~RCPWrapper()                            = default;
+  /** Move constructor */
+  RCPWrapper(RCPWrapper&& pw) : m_ptr{pw.m_ptr}, m_tagged_ctrl{pw.m_tagged_ctrl} {
+    pw.m_ptr         = nullptr;
+    pw.m_tagged_ctrl = 0;
+  }
+
+  /** Assignment operator */
+  RCPWrapper& operator=(RCPWrapper pw) {
+    std::swap(m_ptr, pw.m_ptr);
+    std::swap(m_tagged_ctrl, pw.m_tagged_ctrl);
+    return *this;
+  }
+
+  ~RCPWrapper() { release(); }
   ///@}
 
   /** \brief Check if this object is empty or not */
   explicit operator bool() const { return get() != nullptr; }
 
   /** \brief Raw access to the inner pointer */
-  T* get() const {
-    if (m_contains_shared_ptr) return m_shared_ptr.get();
-    return m_subscr_ptr.get();
-  }
+  T* get() const { return m_ptr; }
 
   /** Dereference object */
   T& operator*() const {
@@ -180,9 +214,10 @@ class RCPWrapper<T, typename krims::enable_if_t<IsSubscribable<T>::value &&
    * \note This operation is only allowed in Release mode or if this wrapper
    *       actually contains a shared pointer.*/
   explicit operator std::shared_ptr<T>() const {
-    if (m_contains_shared_ptr) {
-      return m_shared_ptr;
-    } else if (m_subscr_ptr == nullptr) {
+    if (is_shared_ptr()) {
+      if (m_ptr == nullptr) return std::shared_ptr<T>{};
+      return std::shared_ptr<T>(owner_block()->owner, m_ptr);
+    } else if (m_ptr == nullptr) {
       return std::shared_ptr<T>{};
     } else {
       assert_dbg(false,
@@ -191,7 +226,7 @@ class RCPWrapper<T, typename krims::enable_if_t<IsSubscribable<T>::value &&
                              "full data and is hence disabled. Perform an explicit copy "
                              "instead by dereferencing the result of the get() function "
                              "and employing it together with std::make_shared."));
-      return std::make_shared<T>(*m_subscr_ptr);
+      return std::make_shared<T>(*m_ptr);
     }
   }
 
@@ -201,18 +236,19 @@ class RCPWrapper<T, typename krims::enable_if_t<IsSubscribable<T>::value &&
    * since T is a subscribable type anyways.
    */
   operator SubscriptionPointer<T>() const {
-    if (!m_contains_shared_ptr) {
-      // we contain a subscription pointer, so return a
-      // copy of it
-      return m_subscr_ptr;
-    } else if (m_shared_ptr == nullptr) {
-      // We contain no valid shared pointer either
-      // ... return subscription to nullptr:
-      return SubscriptionPointer<T>("RCPWrapper");
+#ifdef DEBUG
+    // Keep the subscriber id if we contain a subscription pointer
+    const std::string& id = *subscriber_id();
+#else
+    const std::string id;
+#endif
+    if (m_ptr == nullptr) {
+      // Return subscription to nullptr:
+      return SubscriptionPointer<T>(id);
     } else {
       // Here we have a valid object to point to
       // Subscribe to it:
-      return SubscriptionPointer<T>("RCPWrapper", *m_shared_ptr);
+      return SubscriptionPointer<T>(id, *m_ptr);
     }
   }
 
@@ -224,17 +260,84 @@ class RCPWrapper<T, typename krims::enable_if_t<IsSubscribable<T>::value &&
    *       the program in Debug mode, but will proceed in Release mode and
    *       thereby copy the contained data.
    **/
-  bool is_shared_ptr() const { return m_contains_shared_ptr; }
+  bool is_shared_ptr() const { return (m_tagged_ctrl & subscribed_bit) == 0; }
 
  private:
-  //! Does this class contain a shared pointer?
-  bool m_contains_shared_ptr;
+  //! The bit of m_tagged_ctrl, which is set for subscriptions
+  static constexpr uintptr_t subscribed_bit = 1;
+
+  /** The subscriber id used by RCPWrappers, which have not been constructed
+   *  from a SubscriptionPointer (nullptr in RELEASE mode) */
+  static const std::string* default_subscriber_id() {
+#ifdef DEBUG
+    static const std::string* id_ptr = detail::intern_subscriber_id("RCPWrapper");
+    return id_ptr;
+#else
+    return nullptr;
+#endif
+  }
 
-  //! The stored subscription pointer (or a nullptr)
-  SubscriptionPointer<T> m_subscr_ptr;
+  /** The control block (only valid if is_shared_ptr() and non-empty) */
+  detail::RCPOwnerBlock* owner_block() const {
+    return reinterpret_cast<detail::RCPOwnerBlock*>(m_tagged_ctrl);
+  }
 
-  //! The stored shared pointer (or a nullptr)
-  std::shared_ptr<T> m_shared_ptr;
+#ifdef DEBUG
+  /** The slot of the subscription (only valid if !is_shared_ptr() and non-empty) */
+  detail::SubscriptionSlot* subscription_slot() const {
+    return reinterpret_cast<detail::SubscriptionSlot*>(m_tagged_ctrl & ~subscribed_bit);
+  }
+#endif
+
+  /** The interned subscriber id of the subscription held by this wrapper
+   *  (or the default id if the wrapper holds no subscription) */
+  const std::string* subscriber_id() const {
+#ifdef DEBUG
+    if (m_ptr != nullptr && !is_shared_ptr()) {
+      return subscription_slot()->id_ptr.load(std::memory_order_acquire);
+    }
+#endif
+    return default_subscriber_id();
+  }
+
+  /** Register the reference to the object held by this wrapper, i.e.
+   *  increase the reference count or subscribe to the object under
+   *  the given subscriber id. */
+  void acquire(const std::string* id_ptr) {
+    (void)id_ptr;
+    if (m_ptr == nullptr) return;
+    if (is_shared_ptr()) {
+      owner_block()->n_refs.fetch_add(1, std::memory_order_relaxed);
+    } else {
+#ifdef DEBUG
+      detail::SubscriptionSlot* slot_ptr = m_ptr->subscribe(id_ptr);
+      m_tagged_ctrl = reinterpret_cast<uintptr_t>(slot_ptr) | subscribed_bit;
+#elif defined(KRIMS_SUBSCRIPTION_COUNTING)
+      m_ptr->subscribe();
+#endif
+    }
+  }
+
+  /** Remove the reference to the object held by this wrapper */
+  void release() {
+    if (m_ptr == nullptr) return;
+    if (is_shared_ptr()) {
+      detail::RCPOwnerBlock* block = owner_block();
+      if (block->n_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete block;
+    } else {
+#ifdef DEBUG
+      m_ptr->unsubscribe(subscription_slot());
+#elif defined(KRIMS_SUBSCRIPTION_COUNTING)
+      m_ptr->unsubscribe();
+#endif
+    }
+  }
+
+  //! The pointer to the object
+  T* m_ptr;
+
+  //! Tagged pointer to the control block or the subscription slot (see above)
+  uintptr_t m_tagged_ctrl;
 };
 
 //
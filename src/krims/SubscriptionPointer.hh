@@ -25,16 +25,94 @@
 #include <type_traits>
 #include <utility>
 
+#ifdef DEBUG
+#include <mutex>
+#include <unordered_set>
+#endif
+
 namespace krims {
 
 // Forward-declare Subscribable
 class Subscribable;
 
+#ifdef DEBUG
+namespace detail {
+/** Hash and equality of pointers to subscriber ids, which compare the ids
+ *  they point to */
+struct SubscriberIdPtrHash {
+  size_t operator()(const std::string* id_ptr) const {
+    return std::hash<std::string>()(*id_ptr);
+  }
+};
+struct SubscriberIdPtrEqual {
+  bool operator()(const std::string* lhs, const std::string* rhs) const {
+    return *lhs == *rhs;
+  }
+};
+
+/** Return a pointer to the unique copy of a subscriber id.
+ *
+ * Equal ids yield the same pointer, such that SubscriptionPointers
+ * only need to store and copy this pointer instead of a string.
+ * The copies are kept until the end of the program (also beyond the
+ * destruction of static and thread-local objects, which might still hold
+ * subscriptions).
+ *
+ * Each thread caches pointers to the ids it has interned, such that the lock
+ * of the global set of ids is only taken the first time a thread uses an id.
+ * Once the cache of a thread has been destroyed (e.g. in destructors of
+ * static or thread-local objects) the global set is used directly.
+ */
+inline const std::string* intern_subscriber_id(const std::string& id) {
+  typedef std::unordered_set<const std::string*, SubscriberIdPtrHash,
+                             SubscriberIdPtrEqual>
+        set_type;
+  static thread_local bool cache_destroyed = false;
+  struct Cache {
+    set_type ids;
+    ~Cache() { cache_destroyed = true; }
+  };
+
+  Cache* cache_ptr = nullptr;
+  if (!cache_destroyed) {
+    static thread_local Cache cache;
+    cache_ptr = &cache;
+    auto it   = cache.ids.find(&id);
+    if (it != cache.ids.end()) return *it;
+  }
+
+  static std::mutex mutex;
+  static std::unordered_set<std::string>* ids_ptr = new std::unordered_set<std::string>;
+  const std::string* id_ptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    id_ptr = &*ids_ptr->insert(id).first;
+  }
+  if (cache_ptr != nullptr) cache_ptr->ids.insert(id_ptr);
+  return id_ptr;
+}
+}  // namespace detail
+#endif  // DEBUG
+
+/** \brief Pointer to a Subscribable object, which is registered at the object.
+ *
+ * In DEBUG mode the pointer subscribes to the object under a subscriber id,
+ * such that the object can detect if it is destroyed while still being
+ * referenced. In RELEASE mode no subscription takes place and neither is
+ * the subscriber id stored, such that the SubscriptionPointer is just
+ * a plain raw pointer. If krims is configured with KRIMS_SUBSCRIPTION_COUNTING,
+ * the pointer is still a plain raw pointer in RELEASE mode, but counts as a
+ * subscription at the object.
+ */
 template <typename T>
 class SubscriptionPointer {
   static_assert(std::is_base_of<Subscribable, T>::value,
                 "T must be a child class of Subscribable");
 
+  // Make other SubscriptionPointers friends
+  template <typename U>
+  friend class SubscriptionPointer;
+
  public:
   /** The template parameter T, i.e. the type of the managed object */
   typedef T element_type;
@@ -43,11 +121,17 @@ class SubscriptionPointer {
    *
    * Actual subscription to an object may be done using the reset function.
    *
-   * \param subscriber_id Id used for the subscription.
+   * \param subscriber_id Id used for the subscription (only used in DEBUG mode)
    * */
   explicit SubscriptionPointer(const std::string& subscriber_id)
-        : m_subscribed_obj_ptr(nullptr),
-          m_subscriber_id_ptr(new std::string(subscriber_id)) {}
+        : m_subscribed_obj_ptr(nullptr)
+#ifdef DEBUG
+        , m_subscriber_id_ptr(detail::intern_subscriber_id(subscriber_id)),
+          m_slot_ptr(nullptr)
+#endif
+  {
+    (void)subscriber_id;
+  }
 
   /** Create a Subscription pointer from a Subscribable Class and an
    * identifier
@@ -67,35 +151,48 @@ class SubscriptionPointer {
 
   /** Copy constructor */
   SubscriptionPointer(const SubscriptionPointer& other)
-        : m_subscribed_obj_ptr(nullptr),
-          m_subscriber_id_ptr(new std::string(*(other.m_subscriber_id_ptr))) {
+        : m_subscribed_obj_ptr(nullptr)
+#ifdef DEBUG
+        , m_subscriber_id_ptr(other.m_subscriber_id_ptr),
+          m_slot_ptr(nullptr)
+#endif
+  {
     register_at(other.m_subscribed_obj_ptr);
   }
 
   /** \brief Implicit conversion from a different element type */
   template <typename U, typename = enable_if_t<std::is_convertible<U*, T*>::value>>
   SubscriptionPointer(const SubscriptionPointer<U>& other)
-        : m_subscribed_obj_ptr(nullptr),
-          m_subscriber_id_ptr(new std::string(other.subscriber_id())) {
+        : m_subscribed_obj_ptr(nullptr)
+#ifdef DEBUG
+        , m_subscriber_id_ptr(other.m_subscriber_id_ptr),
+          m_slot_ptr(nullptr)
+#endif
+  {
     register_at(other.get());  // Register (here the ptr conversion happens)
   }
 
   /** Move constructor */
   SubscriptionPointer(SubscriptionPointer&& other)
-        : m_subscribed_obj_ptr(other.m_subscribed_obj_ptr),
-          m_subscriber_id_ptr(std::move(other.m_subscriber_id_ptr)) {
+        : m_subscribed_obj_ptr(other.m_subscribed_obj_ptr)
+#ifdef DEBUG
+        , m_subscriber_id_ptr(other.m_subscriber_id_ptr),
+          m_slot_ptr(other.m_slot_ptr)
+#endif
+  {
     other.m_subscribed_obj_ptr = nullptr;
   }
 
   /** Assignment operator */
   SubscriptionPointer& operator=(SubscriptionPointer other) {
-#ifdef DEBUG
     register_at(nullptr);  // Unregister us first
+#ifdef DEBUG
+    m_subscriber_id_ptr = other.m_subscriber_id_ptr;
+    m_slot_ptr          = other.m_slot_ptr;
 #endif
 
     // Move the subscription of other over:
     m_subscribed_obj_ptr       = other.m_subscribed_obj_ptr;
-    m_subscriber_id_ptr        = std::move(other.m_subscriber_id_ptr);
     other.m_subscribed_obj_ptr = nullptr;
 
     return *this;
@@ -125,8 +222,18 @@ class SubscriptionPointer {
   /** Dereference object member */
   T* operator->() const { return m_subscribed_obj_ptr; }
 
-  /** Obtain the subscriber id provided upon construction. */
-  const std::string& subscriber_id() const { return *m_subscriber_id_ptr; }
+  /** Obtain the subscriber id provided upon construction.
+   *
+   * \note In RELEASE mode the id is not stored and an empty string
+   * is returned instead. */
+  const std::string& subscriber_id() const {
+#ifdef DEBUG
+    return *m_subscriber_id_ptr;
+#else
+    static const std::string empty_id;
+    return empty_id;
+#endif
+  }
 
  private:
   /** Register at the given object */
@@ -134,15 +241,21 @@ class SubscriptionPointer {
 #ifdef DEBUG
     if (m_subscribed_obj_ptr) {
       // Unregister subscription of this pointer from old object
-      m_subscribed_obj_ptr->unsubscribe(m_subscriber_id_ptr);
+      m_subscribed_obj_ptr->unsubscribe(m_slot_ptr);
       m_subscribed_obj_ptr = nullptr;
+      m_slot_ptr           = nullptr;
     }
 
     if (object_ptr) {
       // Register subscription at new object
-      object_ptr->subscribe(m_subscriber_id_ptr);
+      m_slot_ptr           = object_ptr->subscribe(m_subscriber_id_ptr);
       m_subscribed_obj_ptr = object_ptr;
     }
+#elif defined(KRIMS_SUBSCRIPTION_COUNTING)
+    // Only count the subscriptions
+    if (m_subscribed_obj_ptr) m_subscribed_obj_ptr->unsubscribe();
+    if (object_ptr) object_ptr->subscribe();
+    m_subscribed_obj_ptr = object_ptr;
 #else
     // Since we have no subscribing/unsubscribing business to do:
     m_subscribed_obj_ptr = object_ptr;
@@ -152,15 +265,12 @@ class SubscriptionPointer {
   /// Pointer to the actual object.
   T* m_subscribed_obj_ptr;
 
-/** The pointer which is the unique identifier of this very pointer object
- *  Note that in DEBUG the actual pointer address is used as the identifier
- *  such that just barely using the string value is not enough
- */
 #ifdef DEBUG
-  std::shared_ptr<const std::string> m_subscriber_id_ptr;
-#else
-  // use unique_ptr in RELEASE mode since this guy is way faster.
-  std::unique_ptr<const std::string> m_subscriber_id_ptr;
+  /** Pointer to the interned subscriber id (see detail::intern_subscriber_id) */
+  const std::string* m_subscriber_id_ptr;
+
+  /** The slot of our subscription at the object (needed to unsubscribe) */
+  detail::SubscriptionSlot* m_slot_ptr;
 #endif
 };
 
@@ -0,0 +1,78 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "krims/config.hh"
+#include <memory>
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+#include <memory_resource>
+
+namespace krims {
+namespace detail {
+
+/** \brief Allocator which allocates from a memory resource and shares ownership
+ *  of it.
+ *
+ * Used with ``std::allocate_shared`` to place objects in the arena of a
+ * GenMap. Since the control block of the shared pointer keeps a copy
+ * of the allocator, the arena lives until the last object allocated from it
+ * has been destroyed, even if the object is shared with other maps.
+ */
+template <typename T>
+class GenMapArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit GenMapArenaAllocator(std::shared_ptr<std::pmr::memory_resource> resource_ptr)
+        : m_resource_ptr{std::move(resource_ptr)} {}
+
+  template <typename U>
+  GenMapArenaAllocator(const GenMapArenaAllocator<U>& other)
+        : m_resource_ptr{other.resource_ptr()} {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(m_resource_ptr->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    m_resource_ptr->deallocate(ptr, n * sizeof(T), alignof(T));
+  }
+
+  const std::shared_ptr<std::pmr::memory_resource>& resource_ptr() const {
+    return m_resource_ptr;
+  }
+
+ private:
+  std::shared_ptr<std::pmr::memory_resource> m_resource_ptr;
+};
+
+template <typename T, typename U>
+bool operator==(const GenMapArenaAllocator<T>& lhs, const GenMapArenaAllocator<U>& rhs) {
+  return *lhs.resource_ptr() == *rhs.resource_ptr();
+}
+
+template <typename T, typename U>
+bool operator!=(const GenMapArenaAllocator<T>& lhs, const GenMapArenaAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace detail
+}  // namespace krims
+#endif  // KRIMS_HAVE_MEMORY_RESOURCE
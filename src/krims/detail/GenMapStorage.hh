@@ -0,0 +1,249 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "GenMapArena.hh"
+#include "GenMapTraits.hh"
+#include "krims/GenMapFingerprint.hh"
+#include "krims/GenMapWatch.hh"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace krims {
+namespace detail {
+
+/** The data which is shared between a GenMap and all submaps derived from it. */
+struct GenMapStorage {
+  typedef typename GenMapTraits::map_type map_type;
+  typedef std::map<std::string, GenMapFingerprint, GenMapKeyLess> fingerprint_map_type;
+  typedef std::set<std::string, GenMapKeyLess> key_set_type;
+
+  /** Construct an empty storage */
+  GenMapStorage()
+        : map_ptr{std::make_shared<map_type>()},
+          generation{next_generation()},
+          location{""} {}
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  /** Construct an empty storage, which allocates the nodes of its map
+   *  and the values made by make_value from the provided arena. */
+  explicit GenMapStorage(std::shared_ptr<std::pmr::memory_resource> arena_ptr_)
+        : map_ptr{nullptr},
+          generation{next_generation()},
+          location{""},
+          arena_ptr{std::move(arena_ptr_)} {
+    map_ptr = make_map();
+  }
+#endif
+
+  /** Construct a storage holding a copy of the provided map */
+  explicit GenMapStorage(const map_type& other_map)
+        : map_ptr{std::make_shared<map_type>(other_map)},
+          generation{next_generation()},
+          location{""} {}
+
+  /** Construct a storage which shares the map with another storage until
+   *  either of them is modified.
+   *
+   *  Only the entries of the subtree below the full key ``location_``
+   *  are of interest to the new storage, such that only these are copied once
+   *  the map needs to be unshared.
+   */
+  GenMapStorage(std::shared_ptr<map_type> shared_map, std::string location_)
+        : map_ptr{std::move(shared_map)},
+          generation{next_generation()},
+          location{std::move(location_)} {}
+
+  /** Return the map, making sure it is no longer shared with other storage
+   * objects first. Must be used whenever the map or the entry values
+   * (as opposed to the data they point to) are modified. */
+  map_type& map_for_writing() {
+    if (is_shared()) unshare();
+    return *map_ptr;
+  }
+
+  /** Return a new empty map, whose nodes are allocated from the arena (if any) */
+  std::shared_ptr<map_type> make_map() const;
+
+  /** Make a new object of type T for storage in the map, which is allocated
+   *  from the arena (if any) */
+  template <typename T, typename... Args>
+  std::shared_ptr<T> make_value(Args&&... args) const;
+
+  /** Is the map shared with another storage object */
+  bool is_shared() const { return map_ptr.use_count() > 1; }
+
+  /** Copy the relevant part of the map, such that it is no longer
+   *  shared with another storage. This invalidates all iterators. */
+  void unshare();
+
+  /** Mark that entries of the map have been removed, such that
+   *  iterators into the map which are cached elsewhere are no longer valid. */
+  void invalidate_iterators() { generation = next_generation(); }
+
+  /** Mark that any entries of the map may have been modified, such
+   *  that all cached fingerprints need to be recomputed. */
+  void invalidate_fingerprints() { fingerprints.clear(); }
+
+  /** Mark that the entries at or below the full key ``full_key`` may have been
+   *  modified, such that the cached fingerprints of all subtrees containing
+   *  such entries need to be recomputed. */
+  void invalidate_fingerprints(const std::string& full_key);
+
+  /** Mark that the entries at or below the full key ``full_key`` are about to
+   *  be modified. Drops the affected fingerprints and records the change
+   *  for the watches, if there are any. */
+  void mark_modified(const std::string& full_key) {
+    ++modification_count;
+    invalidate_fingerprints(full_key);
+    if (!watches.empty()) pending_changes.insert(full_key);
+  }
+
+  /** Mark that the entries in the range [first, last) are about to be erased */
+  void mark_modified(map_type::const_iterator first, map_type::const_iterator last) {
+    if (first == last) return;
+    ++modification_count;
+    for (; first != last; ++first) {
+      invalidate_fingerprints(first->first);
+      if (!watches.empty()) pending_changes.insert(first->first);
+    }
+  }
+
+  /** The actual map from the full keys to the values.
+   *
+   * May be shared with other storage objects in a copy-on-write fashion
+   * (see GenMap::fork), such that it may only be modified via
+   * map_for_writing().
+   */
+  std::shared_ptr<map_type> map_ptr;
+
+  /** The generation of the map.
+   *
+   * Changes whenever entries are removed from the map or the map is unshared.
+   * The values are taken from a process-wide counter, such that no two storage
+   * objects ever share a generation value. Since insertion into the map does not
+   * invalidate any iterators, this value does not change on insertion.
+   */
+  size_t generation;
+
+  /** The full key of the subtree which is accessible via this storage.
+   *  Empty if the full map is accessible. */
+  std::string location;
+
+  /** The number of calls to mark_modified, i.e. the number of times entries
+   *  have been inserted, replaced or erased. Used to detect whether
+   *  pointers to the values cached elsewhere are still valid. */
+  size_t modification_count = 0;
+
+  /** The fingerprints of the subtrees, which have been computed by
+   *  GenMap::fingerprint, by the full key of the subtree.
+   *
+   * Subtrees below the requested one consisting of a single entry are not
+   * stored. Since fingerprint is a const function, the map is only accessed
+   * with fingerprints_mutex locked from there. */
+  fingerprint_map_type fingerprints;
+
+  //! Mutex protecting the fingerprints against concurrent calls to fingerprint
+  std::mutex fingerprints_mutex;
+
+  /** The watches subscribed to changes of the map (see GenMap::watch).
+   *  Expired entries are removed on GenMap::flush. */
+  std::vector<std::weak_ptr<GenMapWatch::State>> watches;
+
+  /** The full keys modified since the last GenMap::flush.
+   *  Only recorded if watches is not empty. */
+  key_set_type pending_changes;
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  /** The arena from which the map nodes and the values obtained from make_value
+   *  are allocated. If it is a nullptr, the default heap is used. */
+  std::shared_ptr<std::pmr::memory_resource> arena_ptr;
+#endif
+
+ private:
+  /** Return a generation value which has never been returned before
+   *  (The value 0 is never returned)*/
+  static size_t next_generation() {
+    static std::atomic<size_t> counter{0};
+    return ++counter;
+  }
+};
+
+//
+// ---------------------------------------------------------
+//
+
+inline std::shared_ptr<GenMapStorage::map_type> GenMapStorage::make_map() const {
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  if (arena_ptr != nullptr) {
+    // The control block shares ownership of the arena, such that the arena
+    // lives as long as the map, even if the map is shared with a fork.
+    return std::allocate_shared<map_type>(GenMapArenaAllocator<map_type>(arena_ptr),
+                                          GenMapTraits::allocator_type(arena_ptr.get()));
+  }
+#endif
+  return std::make_shared<map_type>();
+}
+
+template <typename T, typename... Args>
+std::shared_ptr<T> GenMapStorage::make_value(Args&&... args) const {
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  if (arena_ptr != nullptr) {
+    return std::allocate_shared<T>(GenMapArenaAllocator<T>(arena_ptr),
+                                   std::forward<Args>(args)...);
+  }
+#endif
+  return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+inline void GenMapStorage::unshare() {
+  auto copy_ptr = make_map();
+  if (location.empty()) {
+    *copy_ptr = *map_ptr;
+  } else {
+    // Copy the subtree below location, which is the range [location,
+    // location + '\0') of the map (see GenMapKeyLess).
+    std::string bound{location};
+    bound.push_back('\0');
+    copy_ptr->insert(map_ptr->lower_bound(location), map_ptr->lower_bound(bound));
+  }
+  map_ptr = std::move(copy_ptr);
+  invalidate_iterators();
+}
+
+inline void GenMapStorage::invalidate_fingerprints(const std::string& full_key) {
+  if (fingerprints.empty()) return;
+
+  // The subtree of full_key itself and all subtrees below it
+  std::string bound{full_key};
+  bound.push_back('\0');
+  fingerprints.erase(fingerprints.lower_bound(full_key), fingerprints.lower_bound(bound));
+
+  // The subtrees full_key is part of, i.e. all its parent paths down to the root ""
+  for (size_t pos = full_key.rfind('/'); pos != std::string::npos;
+       pos        = pos == 0 ? std::string::npos : full_key.rfind('/', pos - 1)) {
+    fingerprints.erase(full_key.substr(0, pos));
+  }
+}
+
+}  // namespace detail
+}  // namespace krims
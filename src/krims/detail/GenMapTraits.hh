@@ -19,19 +19,170 @@
 
 #pragma once
 #include "GenMapValue.hh"
+#include "krims/config.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <map>
+#include <string>
+
+#ifdef KRIMS_HAVE_CXX17
+#include <string_view>
+#endif
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+#include <memory_resource>
+#endif
 
 namespace krims {
 namespace detail {
 
+/** A full GenMap key, which is split into the location of a GenMap inside the
+ *  tree and the path relative to this location. The represented key is
+ *  ``location + "/" + path`` if path is non-empty and ``location`` otherwise.
+ *
+ * Used for looking up keys in the map without building the concatenated
+ * string first.
+ */
+struct GenMapSplitKey {
+  const char* location;
+  size_t location_size;
+  const char* path;
+  size_t path_size;
+};
+
+/** The comparator used to order the keys inside the GenMap.
+ *
+ * Keys are compared lexicographically, but with the path separator '/'
+ * ordered before all other characters. As a result all keys of a subtree,
+ * i.e. "/a" and all keys starting with "/a/", form a contiguous range in the
+ * map, which is not interleaved with keys like "/a-b" or "/ab". The end
+ * of this range is the lower bound of "/a" followed by a '\0' character.
+ *
+ * Apart from comparing std::string objects it is able to compare
+ * full keys with GenMapSplitKey objects, such that such keys may be used for
+ * lookup without allocating a std::string for them.
+ * */
+struct GenMapKeyLess {
+  //! Mark comparator as transparent (C++14 heterogeneous lookup)
+  typedef void is_transparent;
+
+  bool operator()(const std::string& lhs, const std::string& rhs) const {
+    return compare(lhs, rhs) < 0;
+  }
+  bool operator()(const std::string& lhs, const GenMapSplitKey& rhs) const {
+    return compare(lhs, rhs) < 0;
+  }
+  bool operator()(const GenMapSplitKey& lhs, const std::string& rhs) const {
+    return compare(rhs, lhs) > 0;
+  }
+
+  /** Three-way comparison of two full keys
+   *  (negative if lhs is smaller, zero if equal, else positive) */
+  static int compare(const std::string& lhs, const std::string& rhs);
+
+  /** Three-way comparison of a full key with a split key
+   *  (negative if lhs is smaller, zero if equal, else positive) */
+  static int compare(const std::string& lhs, const GenMapSplitKey& rhs);
+
+ private:
+  /** Three-way comparison of the first n characters of lhs and rhs
+   *  in the ordering described above. */
+  static int compare_chars(const char* lhs, const char* rhs, size_t n);
+};
+
 /** Struct which defines the basic types used throughout the GenMap implementation. */
 struct GenMapTraits {
   //! The type used to store the entries of arbitrary type.
   typedef GenMapValue entry_value_type;
 
+  //! The comparator used to order the keys.
+  typedef GenMapKeyLess key_compare;
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  /** The allocator used for the nodes of the map. Allows to allocate the nodes
+   *  from an arena (see GenMap::GenMap(std::shared_ptr<std::pmr::memory_resource>)) */
+  typedef std::pmr::polymorphic_allocator<std::pair<const std::string, entry_value_type>>
+        allocator_type;
+#else
+  typedef std::allocator<std::pair<const std::string, entry_value_type>> allocator_type;
+#endif
+
   //! The type used as the map string to the entry value.
-  typedef std::map<std::string, entry_value_type> map_type;
+  typedef std::map<std::string, entry_value_type, key_compare, allocator_type> map_type;
+
+#ifdef KRIMS_HAVE_CXX17
+  /** The type used to pass keys to the lookup functions of the GenMap
+   *  (std::string_view if available, else std::string) */
+  typedef std::string_view key_view_type;
+#else
+  typedef std::string key_view_type;
+#endif
 };
 
+//
+// ---------------------------------------------------------
+//
+
+inline int GenMapKeyLess::compare_chars(const char* lhs, const char* rhs, size_t n) {
+  // Skip the common prefix in blocks of 8 characters
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+    uint64_t lhs_block, rhs_block;
+    std::memcpy(&lhs_block, lhs + i, sizeof(uint64_t));
+    std::memcpy(&rhs_block, rhs + i, sizeof(uint64_t));
+    if (lhs_block != rhs_block) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+      __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      // The lowest set bit of the difference is in the first differing character
+      i += static_cast<size_t>(__builtin_ctzll(lhs_block ^ rhs_block)) / 8;
+#endif
+      break;
+    }
+  }
+
+  // Find the first differing character. '/' is mapped below all
+  // other characters, which are compared as unsigned char.
+  auto rank = [](char c) { return c == '/' ? -1 : static_cast<unsigned char>(c); };
+  for (; i < n; ++i) {
+    if (lhs[i] != rhs[i]) return rank(lhs[i]) - rank(rhs[i]);
+  }
+  return 0;
+}
+
+inline int GenMapKeyLess::compare(const std::string& lhs, const std::string& rhs) {
+  const int res = compare_chars(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()));
+  if (res != 0 || lhs.size() == rhs.size()) return res;
+  return lhs.size() < rhs.size() ? -1 : 1;
+}
+
+inline int GenMapKeyLess::compare(const std::string& lhs, const GenMapSplitKey& rhs) {
+  const size_t lhs_size = lhs.size();
+
+  // Compare location part
+  const size_t n_loc = std::min(lhs_size, rhs.location_size);
+  int res            = compare_chars(lhs.data(), rhs.location, n_loc);
+  if (res != 0) return res;
+  if (lhs_size <= rhs.location_size) {
+    // Equal if both sizes are equal and there is no path part.
+    if (lhs_size == rhs.location_size && rhs.path_size == 0) return 0;
+    return -1;
+  }
+  if (rhs.path_size == 0) return 1;  // lhs is longer than rhs
+
+  // Compare the '/' separating location and path part.
+  // Since '/' is the smallest character, lhs is larger if it differs here.
+  if (lhs[rhs.location_size] != '/') return 1;
+
+  // Compare path part
+  const size_t offset   = rhs.location_size + 1;
+  const size_t lhs_rest = lhs_size - offset;
+  const size_t n_path   = std::min(lhs_rest, rhs.path_size);
+  res                   = compare_chars(lhs.data() + offset, rhs.path, n_path);
+  if (res != 0) return res;
+  if (lhs_rest == rhs.path_size) return 0;
+  return lhs_rest < rhs.path_size ? -1 : 1;
+}
+
 }  // namespace detail
 }  // namespace krims
@@ -19,10 +19,18 @@
 
 #pragma once
 #include "krims/ExceptionSystem/Exceptions.hh"
+#include "krims/LazyValue.hh"
 #include "krims/RCPWrapper.hh"
 #include "krims/SubscriptionPointer.hh"
 #include "krims/TypeUtils.hh"
 #include "krims/demangle.hh"
+#include "krims/detail/Hash128.hh"
+#include <atomic>
+#include <complex>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <typeinfo>
 
 namespace krims {
 
@@ -31,6 +39,81 @@ class GenMap;
 
 namespace detail {
 
+/** Information about a type of object stored in a GenMapValue.
+ *
+ * There is one constant object of this kind per type (see GenMapValueTypeOf),
+ * such that a GenMapValue only needs to store a pointer to it.
+ */
+struct GenMapValueType {
+  typedef void (*hash_function_type)(const void* object, Hash128& hash);
+
+  //! The type_info of the type
+  const std::type_info* info;
+
+  /** Function to add the value of an object of this type to a hash
+   *  (nullptr if the value cannot be hashed) */
+  hash_function_type add_to_hash;
+};
+
+//! The GenMapValueType object of the type T (with const removed)
+template <typename T>
+struct GenMapValueTypeOf {
+  static const GenMapValueType value;
+};
+
+/** The state of a value stored in a GenMapValue, which is computed
+ *  on first access (see LazyValue). */
+class GenMapLazyState {
+ public:
+  GenMapLazyState() : m_once{}, m_evaluated{false}, m_value_ptr{nullptr} {}
+  virtual ~GenMapLazyState() = default;
+
+  /** Return the pointer to the value, which is computed first if
+   *  this has not yet been done. */
+  const std::shared_ptr<void>& value_ptr() {
+    if (!evaluated()) evaluate();
+    return m_value_ptr;
+  }
+
+  /** Has the value been computed already */
+  bool evaluated() const { return m_evaluated.load(std::memory_order_acquire); }
+
+ protected:
+  /** Call the factory and return a pointer to the computed value */
+  virtual std::shared_ptr<void> compute() = 0;
+
+ private:
+  /** Compute the value exactly once, even if called from many threads */
+  void evaluate() {
+    std::call_once(m_once, [this] {
+      m_value_ptr = compute();
+      m_evaluated.store(true, std::memory_order_release);
+    });
+  }
+
+  std::once_flag m_once;
+  std::atomic<bool> m_evaluated;
+  std::shared_ptr<void> m_value_ptr;
+};
+
+//! The state of a lazily computed value of type T
+template <typename T>
+class GenMapLazyStateOf : public GenMapLazyState {
+ public:
+  explicit GenMapLazyStateOf(std::function<T()> factory)
+        : m_factory{std::move(factory)} {}
+
+ protected:
+  std::shared_ptr<void> compute() override {
+    std::shared_ptr<T> res = std::make_shared<T>(m_factory());
+    m_factory              = nullptr;  // Release the data captured by the factory
+    return res;
+  }
+
+ private:
+  std::function<T()> m_factory;
+};
+
 /** \brief Class to contain an entry value in a GenMap, i.e. the thing the
  *  key string actually points to.
  *
@@ -47,7 +130,7 @@ class GenMapValue {
                 << " The value has type '" << arg2 << "'.");
 
   /** \brief Default constructor: Constructs empty object */
-  GenMapValue() : m_object_ptr_ptr{nullptr} {}
+  GenMapValue() : m_object_ptr{nullptr}, m_type_ptr{nullptr}, m_kind{Kind::DIRECT} {}
 
   /** \brief Make a GenMapValue out of a type which is cheap to copy.
    *
@@ -81,6 +164,11 @@ class GenMapValue {
             typename = krims::enable_if_t<!std::is_same<GenMap, decay_t<T>>::value>>
   GenMapValue(RCPWrapper<T> t_ptr);
 
+  /** Make a GenMapValue from a LazyValue, such that the value is only computed
+   *  on first access */
+  template <typename T>
+  GenMapValue(LazyValue<T> lazy);
+
   /** Make an GenMapValue from a Subscribable object (which is not a GenMap) */
   template <typename T,
             typename std::enable_if<std::is_base_of<Subscribable, T>::value &&
@@ -93,12 +181,14 @@ class GenMapValue {
   template <typename T,
             typename = typename std::enable_if<
                   !std::is_reference<T>::value && !IsCheaplyCopyable<T>::value &&
+                  !IsLazyValue<T>::value &&
                   !std::is_same<GenMap, decay_t<T>>::value>::type>
   GenMapValue(T&& t) : GenMapValue{std::make_shared<T>(std::move(t))} {}
   // Note about the enable_if:
   //   - We need to make sure that T is the actual type (and not a
   //     reference)
   //   - T should not be cheap to copy (else first constructor applies)
+  //   - T should not be a LazyValue (else the LazyValue constructor applies)
   //   - T should not be a GenMap (we do not want maps in maps)
 
   GenMapValue(const GenMapValue&) = default;
@@ -117,94 +207,192 @@ class GenMapValue {
 
   /** Obtain a reference to the internal object */
   template <typename T>
-  T& get() {
-    return *get_ptr<T>();
-  }
+  T& get();
 
   /** Obtain a const reference to the internal object */
   template <typename T>
-  const T& get() const {
-    return *get_ptr<T>();
-  }
+  const T& get() const;
 
   /** Is the object empty */
-  bool empty() const { return m_object_ptr_ptr == nullptr; }
+  bool empty() const { return m_object_ptr == nullptr; }
+
+  /** Has the value been computed already. This is only false for values
+   *  constructed from a LazyValue, which have not yet been accessed. */
+  bool evaluated() const { return m_kind != Kind::LAZY || lazy_state().evaluated(); }
+
+  /** Does the object hold a value of type T (ignoring const), i.e. can it be
+   *  obtained via get<T>() */
+  template <typename T>
+  bool holds() const {
+    return can_get_value_as<T>();
+  }
 
   /** Return the demangled typename of the type of the internal object.
    *
-   *  \note This function only returns a sensible value if the
-   *  code is compiled in DEBUG mode and if type demangling
-   *  is supported by the OS (i.e. if KRIMS_HAVE_LIBSTDCXX_DEMANGLER
-   *  is set).
-   *
-   *  Otherwise either type demangling is not possible or
-   *  for performance reasons no type information is stored
-   *  in this object.
-   *
-   *  In RELEASE builds this function always returns
-   *  the string "<no_typeinfo_available>".
+   *  \note The type name is only demangled if this is supported by the OS
+   *  (i.e. if KRIMS_HAVE_LIBSTDCXX_DEMANGLER is set), otherwise the mangled
+   *  name is returned.
    */
   std::string type_name() const {
-#ifdef DEBUG
-    return demangled_string(m_type_name);
-#else
-    return "<no_typeinfo_available>";
-#endif
+    if (m_type_ptr == nullptr) return "<empty>";
+    return demangled_string(m_type_ptr->info->name());
   }
 
+  /** Add the type and the value of the internal object to a hash.
+   *
+   * The value is only taken into account for the cheaply copyable types
+   * (numbers, enums and std::string), which are neither referenced via an
+   * RCPWrapper nor computed lazily. For all other objects only the type is
+   * hashed (such that lazy values are never computed by hashing them).
+   */
+  void add_to_hash(Hash128& hash) const;
+
  private:
-  //! Stupidly copy the object and set the m_object_ptr_ptr
+  //! Stupidly copy the object and set the m_object_ptr
   template <typename T>
   void copy_in(T t);
 
-#ifdef DEBUG
-  /** Check whether the object pointer stored in m_object_ptr_ptr
-   *  can be obtained as a RCPWrapper<T>
+  //! Store a shared pointer to the object directly.
+  template <typename T>
+  void set_direct(std::shared_ptr<T> t_ptr);
+
+  //! Store the RCPWrapper, since it contains no shared pointer.
+  template <typename T>
+  void set_wrapped(RCPWrapper<T> t_ptr);
+
+  /** Are objects of type T always stored as an RCPWrapper<T>?
+   *
+   * This is the case for subscribable objects: An RCPWrapper owning such an
+   * object allocates its own control block when it is made from a shared
+   * pointer. Storing the wrapper once makes get_ptr a plain copy of it.
    */
   template <typename T>
-  constexpr bool can_get_value_as() const {
-    typedef typename std::remove_const<T>::type nonconstT;
+  static constexpr bool store_wrapped() {
+    return IsSubscribable<T>::value && !IsCheaplyCopyable<T>::value;
+  }
 
-    // Allow if the type is identical to the type originally stored
-    // or if a simple addition of const does the trick.
-    return m_type_name == std::string(typeid(T).name()) ||
-           m_type_name == std::string(typeid(nonconstT).name());
+  //! Return the state of a lazy value
+  GenMapLazyState& lazy_state() const {
+    return *static_cast<GenMapLazyState*>(m_object_ptr.get());
   }
-#endif  // DEBUG
 
-  /** The stored pointer to the RCPWrapper<T>
-   * In other words: Twice dereferencing this will always
-   * get us the object back.
+  /** Check whether the object stored in m_object_ptr can be obtained as a T
+   *
+   * This is the case if T is the type originally stored, possibly with
+   * an added const (which is ignored by typeid). Usually the GenMapValueType
+   * objects are unique, such that the comparison of the pointers suffices.
    */
-  std::shared_ptr<void> m_object_ptr_ptr;
+  template <typename T>
+  bool can_get_value_as() const {
+    return m_type_ptr == &GenMapValueTypeOf<typename std::remove_const<T>::type>::value ||
+           (m_type_ptr != nullptr && *m_type_ptr->info == typeid(T));
+  }
+
+  //! The kinds of objects m_object_ptr may point to
+  enum class Kind : unsigned char {
+    DIRECT,   //!< The object itself
+    WRAPPED,  //!< An RCPWrapper<T> referring to the object
+    LAZY      //!< A GenMapLazyState computing the object
+  };
 
-#ifdef DEBUG
-  std::string m_type_name;
-#endif  // DEBUG
+  /** The pointer owning the stored object.
+   *
+   * If the object is owned by a shared pointer (i.e. for cheaply
+   * copyable values, rvalues and shared pointers) this is a
+   * ``std::shared_ptr<T>`` to the object itself, such that only a single
+   * allocation is needed. If the object is subscribable (see store_wrapped)
+   * or only referenced by a SubscriptionPointer it points to an RCPWrapper<T>
+   * and for lazy values to the GenMapLazyState (see m_kind).
+   */
+  std::shared_ptr<void> m_object_ptr;
+
+  //! The type of the stored object (nullptr if empty)
+  const GenMapValueType* m_type_ptr;
+
+  //! What m_object_ptr points to
+  Kind m_kind;
 };
 
 //
 // ----------------------------------------------------------------
 //
 
+//@{
+/** Add the value of an object of type T to a hash (see GenMapValueType) */
+template <typename T>
+void add_value_to_hash(const void* object, Hash128& hash) {
+  hash.add(object, sizeof(T));
+}
+
+// The x87 extended precision format has padding bytes, which are not hashed.
+template <>
+inline void add_value_to_hash<long double>(const void* object, Hash128& hash) {
+  const bool is_x87 = std::numeric_limits<long double>::digits == 64;
+  hash.add(object, is_x87 ? 10 : sizeof(long double));
+}
+
+template <>
+inline void add_value_to_hash<std::complex<long double>>(const void* object,
+                                                         Hash128& hash) {
+  const long double* parts = static_cast<const long double*>(object);
+  add_value_to_hash<long double>(parts, hash);
+  add_value_to_hash<long double>(parts + 1, hash);
+}
+
+template <>
+inline void add_value_to_hash<std::string>(const void* object, Hash128& hash) {
+  const std::string& str = *static_cast<const std::string*>(object);
+  hash.add_string(str.data(), str.size());
+}
+//@}
+
+//@{
+/** Return the function adding values of type T to a hash
+ *  (nullptr if the value of T cannot be hashed) */
+template <typename T>
+constexpr GenMapValueType::hash_function_type hash_function_of(std::true_type) {
+  return &add_value_to_hash<T>;
+}
+
+template <typename T>
+constexpr GenMapValueType::hash_function_type hash_function_of(std::false_type) {
+  return nullptr;
+}
+//@}
+
+template <typename T>
+const GenMapValueType GenMapValueTypeOf<T>::value = {
+      &typeid(T),
+      hash_function_of<T>(std::integral_constant<
+                          bool, std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+                                      IsComplexNumber<T>::value ||
+                                      std::is_same<T, std::string>::value>{})};
+
 template <typename T, typename>
 GenMapValue::GenMapValue(std::shared_ptr<T> t_ptr) {
-  // see copy_in and m_object_ptr_ptr comments for details why this is done
-  m_object_ptr_ptr = std::make_shared<RCPWrapper<T>>(std::move(t_ptr));
-#ifdef DEBUG
-  m_type_name = std::string(typeid(T).name());
-#endif
+  if (t_ptr == nullptr || store_wrapped<T>()) {
+    set_wrapped(RCPWrapper<T>(std::move(t_ptr)));
+  } else {
+    set_direct(std::move(t_ptr));
+  }
 }
 
 template <typename T, typename>
 GenMapValue::GenMapValue(RCPWrapper<T> t_ptr) {
-  // see copy_in and m_object_ptr_ptr comments for details why this is done
-  m_object_ptr_ptr = std::make_shared<RCPWrapper<T>>(std::move(t_ptr));
-#ifdef DEBUG
-  m_type_name = std::string(typeid(T).name());
-#endif
+  if (t_ptr.is_shared_ptr() && t_ptr != nullptr && !store_wrapped<T>()) {
+    set_direct(static_cast<std::shared_ptr<T>>(t_ptr));
+  } else {
+    set_wrapped(std::move(t_ptr));
+  }
 }
 
+template <typename T>
+GenMapValue::GenMapValue(LazyValue<T> lazy)
+      : m_object_ptr{std::static_pointer_cast<GenMapLazyState>(
+              std::make_shared<GenMapLazyStateOf<T>>(lazy.factory()))},
+        m_type_ptr{&GenMapValueTypeOf<T>::value},
+        m_kind{Kind::LAZY} {}
+
 template <typename T,
           typename std::enable_if<std::is_base_of<Subscribable, T>::value &&
                                         !IsCheaplyCopyable<T>::value &&
@@ -212,50 +400,103 @@ template <typename T,
                                   int>::type>
 GenMapValue::GenMapValue(T& t) {
   SubscriptionPointer<T> t_ptr = make_subscription(t, "GenMapValue");
-
-  // see copy_in and m_object_ptr_ptr comments for details why this is done
-  m_object_ptr_ptr = std::make_shared<RCPWrapper<T>>(std::move(t_ptr));
-
-#ifdef DEBUG
-  m_type_name = std::string(typeid(T).name());
-#endif
+  set_wrapped(RCPWrapper<T>(std::move(t_ptr)));
 }
 
 template <typename T>
 void GenMapValue::copy_in(T t) {
-  // Make a shared pointer out of T:
-  auto t_ptr = std::make_shared<T>(std::move(t));
+  // Make a shared pointer out of T and store it directly
+  set_direct(std::make_shared<T>(std::move(t)));
+}
 
-  // Now enwrap the t_ptr inside a RCPWrapper and make
-  // a shared_ptr to the Wrapper, then set it
-  m_object_ptr_ptr = std::make_shared<RCPWrapper<T>>(t_ptr);
+template <typename T>
+void GenMapValue::set_direct(std::shared_ptr<T> t_ptr) {
+  typedef typename std::remove_const<T>::type nonconstT;
+  m_object_ptr = std::const_pointer_cast<nonconstT>(std::move(t_ptr));
+  m_type_ptr   = &GenMapValueTypeOf<nonconstT>::value;
+  m_kind       = Kind::DIRECT;
+}
 
-#ifdef DEBUG
-  // Keep an eye on the type name
-  m_type_name = std::string(typeid(T).name());
-#endif
+template <typename T>
+void GenMapValue::set_wrapped(RCPWrapper<T> t_ptr) {
+  m_object_ptr = std::make_shared<RCPWrapper<T>>(std::move(t_ptr));
+  m_type_ptr   = &GenMapValueTypeOf<typename std::remove_const<T>::type>::value;
+  m_kind       = Kind::WRAPPED;
 }
 
 template <typename T>
 RCPWrapper<T> GenMapValue::get_ptr() {
   assert_dbg(!empty(), ExcInvalidPointer());
-  assert_dbg(can_get_value_as<T>(),
-             ExcWrongTypeRequested(real_typename<T>(), type_name()));
-
-  // We need to cast and then dereference to get the RCPWrapper of the
-  // appropriate type out.
-  return *std::static_pointer_cast<RCPWrapper<T>>(m_object_ptr_ptr);
+  assert_throw(can_get_value_as<T>(),
+               ExcWrongTypeRequested(real_typename<T>(), type_name()));
+
+  switch (m_kind) {
+    case Kind::DIRECT:
+      return RCPWrapper<T>(std::static_pointer_cast<T>(m_object_ptr));
+    case Kind::WRAPPED:
+      // We need to cast and then dereference to get the RCPWrapper of the
+      // appropriate type out.
+      return *std::static_pointer_cast<RCPWrapper<T>>(m_object_ptr);
+    case Kind::LAZY:
+    default:
+      return RCPWrapper<T>(std::static_pointer_cast<T>(lazy_state().value_ptr()));
+  }
 }
 
 template <typename T>
 RCPWrapper<const T> GenMapValue::get_ptr() const {
   assert_dbg(!empty(), ExcInvalidPointer());
-  assert_dbg(can_get_value_as<const T>(),
-             ExcWrongTypeRequested(real_typename<T>(), type_name()));
+  assert_throw(can_get_value_as<const T>(),
+               ExcWrongTypeRequested(real_typename<T>(), type_name()));
+
+  switch (m_kind) {
+    case Kind::DIRECT:
+      return RCPWrapper<const T>(std::static_pointer_cast<const T>(m_object_ptr));
+    case Kind::WRAPPED:
+      // We need to cast and then dereference to get the RCPWrapper of the
+      // appropriate type out.
+      return *std::static_pointer_cast<RCPWrapper<const T>>(m_object_ptr);
+    case Kind::LAZY:
+    default:
+      return RCPWrapper<const T>(
+            std::static_pointer_cast<const T>(lazy_state().value_ptr()));
+  }
+}
+
+template <typename T>
+T& GenMapValue::get() {
+  assert_dbg(!empty(), ExcInvalidPointer());
+  assert_throw(can_get_value_as<T>(),
+               ExcWrongTypeRequested(real_typename<T>(), type_name()));
+
+  // Only a single dereference if the object is stored directly.
+  if (m_kind == Kind::DIRECT) return *static_cast<T*>(m_object_ptr.get());
+  if (m_kind == Kind::LAZY) return *static_cast<T*>(lazy_state().value_ptr().get());
+  return **static_cast<RCPWrapper<T>*>(m_object_ptr.get());
+}
+
+template <typename T>
+const T& GenMapValue::get() const {
+  assert_dbg(!empty(), ExcInvalidPointer());
+  assert_throw(can_get_value_as<const T>(),
+               ExcWrongTypeRequested(real_typename<T>(), type_name()));
+
+  if (m_kind == Kind::DIRECT) return *static_cast<const T*>(m_object_ptr.get());
+  if (m_kind == Kind::LAZY) return *static_cast<const T*>(lazy_state().value_ptr().get());
+  return **static_cast<const RCPWrapper<const T>*>(m_object_ptr.get());
+}
 
-  // We need to cast and then dereference to get the RCPWrapper of the
-  // appropriate type out.
-  return *std::static_pointer_cast<RCPWrapper<const T>>(m_object_ptr_ptr);
+inline void GenMapValue::add_to_hash(Hash128& hash) const {
+  if (empty()) {
+    hash.add_size(0);
+    return;
+  }
+
+  const char* name = m_type_ptr->info->name();
+  hash.add_string(name, std::strlen(name));
+  if (m_kind == Kind::DIRECT && m_type_ptr->add_to_hash != nullptr) {
+    m_type_ptr->add_to_hash(m_object_ptr.get(), hash);
+  }
 }
 
 }  // namespace detail
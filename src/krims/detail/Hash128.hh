@@ -0,0 +1,168 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace krims {
+namespace detail {
+
+/** A 128-bit hash value */
+struct Hash128Value {
+  uint64_t low;
+  uint64_t high;
+};
+
+/** \brief Incremental computation of a 128-bit hash of a sequence of bytes.
+ *
+ * Implements MurmurHash3 (x64, 128-bit variant) by Austin Appleby,
+ * such that the result only depends on the bytes passed to add(), but not
+ * on how they are split across the calls. The hash is stable between runs
+ * of the program, but not cryptographically secure.
+ */
+class Hash128 {
+ public:
+  Hash128() : m_h1{0}, m_h2{0}, m_length{0}, m_buffer_size{0} {}
+
+  /** Add size bytes starting at data to the hash */
+  void add(const void* data, size_t size);
+
+  /** Add a string, including its size (such that the concatenation of
+   *  two strings hashes differently from the strings added separately) */
+  void add_string(const char* str, size_t size) {
+    add_size(size);
+    add(str, size);
+  }
+
+  /** Add a size value in a platform-independent width */
+  void add_size(size_t size) {
+    const uint64_t size64 = size;
+    add(&size64, sizeof(uint64_t));
+  }
+
+  /** Return the hash of all bytes added so far */
+  Hash128Value finish() const;
+
+ private:
+  static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+  static uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+  }
+
+  /** Mix the first or second half of a block into the state */
+  static uint64_t mix_k1(uint64_t k1) { return rotl(k1 * c1, 31) * c2; }
+  static uint64_t mix_k2(uint64_t k2) { return rotl(k2 * c2, 33) * c1; }
+
+  /** Process a full block of 16 bytes */
+  void process_block(const char* block);
+
+  static constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+  static constexpr uint64_t c2 = 0x4cf5ad432745937full;
+
+  //! The state
+  uint64_t m_h1, m_h2;
+
+  //! The number of bytes added so far
+  uint64_t m_length;
+
+  //! Bytes not yet processed, since they do not form a full block
+  char m_buffer[16];
+  size_t m_buffer_size;
+};
+
+//
+// ---------------------------------------------------------
+//
+
+inline void Hash128::process_block(const char* block) {
+  uint64_t k1, k2;
+  std::memcpy(&k1, block, sizeof(uint64_t));
+  std::memcpy(&k2, block + sizeof(uint64_t), sizeof(uint64_t));
+
+  m_h1 ^= mix_k1(k1);
+  m_h1 = rotl(m_h1, 27) + m_h2;
+  m_h1 = m_h1 * 5 + 0x52dce729;
+
+  m_h2 ^= mix_k2(k2);
+  m_h2 = rotl(m_h2, 31) + m_h1;
+  m_h2 = m_h2 * 5 + 0x38495ab5;
+}
+
+inline void Hash128::add(const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  m_length += size;
+
+  // Complete the block in the buffer first
+  if (m_buffer_size > 0) {
+    const size_t n_fill = std::min(size, sizeof(m_buffer) - m_buffer_size);
+    std::memcpy(m_buffer + m_buffer_size, bytes, n_fill);
+    m_buffer_size += n_fill;
+    bytes += n_fill;
+    size -= n_fill;
+    if (m_buffer_size < sizeof(m_buffer)) return;
+    process_block(m_buffer);
+    m_buffer_size = 0;
+  }
+
+  for (; size >= sizeof(m_buffer); bytes += sizeof(m_buffer), size -= sizeof(m_buffer)) {
+    process_block(bytes);
+  }
+  std::memcpy(m_buffer, bytes, size);
+  m_buffer_size = size;
+}
+
+inline Hash128Value Hash128::finish() const {
+  uint64_t h1 = m_h1;
+  uint64_t h2 = m_h2;
+
+  // Tail (the bytes are read in little-endian order)
+  uint64_t k1 = 0, k2 = 0;
+  auto byte = [this](size_t i) {
+    return static_cast<uint64_t>(static_cast<unsigned char>(m_buffer[i]));
+  };
+  for (size_t i = m_buffer_size; i > 8; --i) k2 ^= byte(i - 1) << (8 * (i - 9));
+  for (size_t i = std::min<size_t>(m_buffer_size, 8); i > 0; --i) {
+    k1 ^= byte(i - 1) << (8 * (i - 1));
+  }
+  if (m_buffer_size > 8) h2 ^= mix_k2(k2);
+  if (m_buffer_size > 0) h1 ^= mix_k1(k1);
+
+  // Finalisation
+  h1 ^= m_length;
+  h2 ^= m_length;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix(h1);
+  h2 = fmix(h2);
+  h1 += h2;
+  h2 += h1;
+  return {h1, h2};
+}
+
+}  // namespace detail
+}  // namespace krims
@@ -0,0 +1,244 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+#include "krims/ExceptionSystem/Exceptions.hh"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace krims {
+namespace detail {
+
+/** A slot of a SubscriptionRegistry, which holds a single subscription.
+ *
+ * A pointer to the slot is the handle of the subscription, which is
+ * needed to cancel it.
+ */
+struct SubscriptionSlot {
+  //! The interned id of the subscriber (nullptr if the slot is free)
+  std::atomic<const std::string*> id_ptr;
+
+  //! Sequence number of the subscription, used to order the subscribers
+  std::atomic<uint64_t> sequence;
+
+  //! Index of the next free slot plus one (0 for none), if the slot is free
+  std::atomic<uint32_t> next_free;
+
+  //! The index of this slot in the registry
+  uint32_t index;
+};
+
+/** \brief Registry of the subscriptions to a Subscribable.
+ *
+ * Subscriptions are stored in slots, which are allocated in chunks of
+ * geometrically growing size and never move. Free slots are kept in a
+ * lock-free list, such that subscribing and unsubscribing are O(1)
+ * and do not take a lock. Only if all slots are in use, a mutex is taken to
+ * allocate the next chunk.
+ *
+ * The list of subscribers is only assembled on request (for diagnostics), by
+ * visiting all slots.
+ */
+class SubscriptionRegistry {
+ public:
+  /** Construct an empty registry for an object of the named class */
+  explicit SubscriptionRegistry(std::string classname)
+        : m_classname{std::move(classname)},
+          m_n_subscriptions{0},
+          m_next_sequence{0},
+          m_free_head{0},
+          m_n_chunks{0},
+          m_chunks{} {}
+
+  ~SubscriptionRegistry() {
+    const size_t n_chunks = m_n_chunks.load(std::memory_order_acquire);
+    for (size_t k = 0; k < n_chunks; ++k) delete[] m_chunks[k].load();
+  }
+
+  SubscriptionRegistry(const SubscriptionRegistry&) = delete;
+  SubscriptionRegistry& operator=(const SubscriptionRegistry&) = delete;
+
+  /** Add a subscription under the interned id and return its slot */
+  SubscriptionSlot* subscribe(const std::string* id_ptr) {
+    SubscriptionSlot* slot = pop_free_slot();
+    while (slot == nullptr) {
+      grow();
+      slot = pop_free_slot();
+    }
+
+    slot->sequence.store(m_next_sequence.fetch_add(1, std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+    slot->id_ptr.store(id_ptr, std::memory_order_release);
+    m_n_subscriptions.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+  }
+
+  /** Cancel the subscription held in a slot.
+   *
+   * \return false if the slot holds no subscription */
+  bool unsubscribe(SubscriptionSlot* slot) {
+    if (slot->id_ptr.exchange(nullptr, std::memory_order_acq_rel) == nullptr) {
+      return false;
+    }
+    m_n_subscriptions.fetch_sub(1, std::memory_order_relaxed);
+    push_free_slot(slot);
+    return true;
+  }
+
+  /** The number of subscriptions */
+  size_t size() const { return m_n_subscriptions.load(std::memory_order_relaxed); }
+
+  /** The ids of all subscribers, from the oldest to the newest subscription */
+  std::vector<std::string> subscribers() const;
+
+  /** The name of the class of the object subscribed to */
+  const std::string& classname() const { return m_classname; }
+
+ private:
+  //! The number of slots in the first chunk
+  static constexpr uint32_t first_chunk_size = 8;
+
+  //! The maximal number of chunks
+  static constexpr size_t max_chunks = 24;
+
+  /** The slot with the given index */
+  SubscriptionSlot& slot_at(uint32_t index) const {
+    // Chunk k holds the indices [first_chunk_size * (2^k - 1),
+    //                            first_chunk_size * (2^(k+1) - 1))
+    const uint32_t q = index / first_chunk_size + 1;
+    uint32_t k       = 0;
+    while ((q >> (k + 1)) != 0) ++k;
+    const uint32_t offset = index - first_chunk_size * ((1u << k) - 1);
+    return m_chunks[k].load(std::memory_order_acquire)[offset];
+  }
+
+  /** Pack an index (plus one) and a tag against the ABA problem into a
+   *  value of the head of the free list */
+  static uint64_t pack(uint32_t index_plus_one, uint64_t tag) {
+    return (tag << 32) | index_plus_one;
+  }
+
+  /** Take a slot from the free list (nullptr if it is empty) */
+  SubscriptionSlot* pop_free_slot() {
+    uint64_t head = m_free_head.load(std::memory_order_acquire);
+    while (true) {
+      const uint32_t index_plus_one = static_cast<uint32_t>(head);
+      if (index_plus_one == 0) return nullptr;
+
+      SubscriptionSlot& slot = slot_at(index_plus_one - 1);
+      const uint32_t next    = slot.next_free.load(std::memory_order_relaxed);
+      if (m_free_head.compare_exchange_weak(head, pack(next, (head >> 32) + 1),
+                                            std::memory_order_acquire)) {
+        return &slot;
+      }
+    }
+  }
+
+  /** Put the chain of free slots from ``first`` to ``last`` onto the free list */
+  void push_free_chain(SubscriptionSlot& first, SubscriptionSlot& last) {
+    uint64_t head = m_free_head.load(std::memory_order_relaxed);
+    do {
+      last.next_free.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    } while (!m_free_head.compare_exchange_weak(
+                head, pack(first.index + 1, (head >> 32) + 1), std::memory_order_release,
+                std::memory_order_relaxed));
+  }
+
+  void push_free_slot(SubscriptionSlot* slot) { push_free_chain(*slot, *slot); }
+
+  /** Allocate the next chunk of slots and put them onto the free list */
+  void grow();
+
+  //! The name of the class of the object subscribed to
+  const std::string m_classname;
+
+  //! The number of subscriptions
+  std::atomic<size_t> m_n_subscriptions;
+
+  //! The sequence number of the next subscription
+  std::atomic<uint64_t> m_next_sequence;
+
+  //! The head of the free list (see pack())
+  std::atomic<uint64_t> m_free_head;
+
+  //! The number of allocated chunks
+  std::atomic<size_t> m_n_chunks;
+
+  //! The chunks of slots
+  std::atomic<SubscriptionSlot*> m_chunks[max_chunks];
+
+  //! Mutex taken to allocate a chunk
+  std::mutex m_grow_mutex;
+};
+
+//
+// ---------------------------------------------------------
+//
+
+inline void SubscriptionRegistry::grow() {
+  std::lock_guard<std::mutex> lock(m_grow_mutex);
+
+  // Another thread might have grown the registry or released slots meanwhile
+  if (static_cast<uint32_t>(m_free_head.load(std::memory_order_acquire)) != 0) return;
+
+  const size_t k = m_n_chunks.load(std::memory_order_relaxed);
+  assert_throw(k < max_chunks, ExcTooLargeOrEqual<size_t>(k, max_chunks));
+
+  const uint32_t size        = first_chunk_size << k;
+  const uint32_t first_index = first_chunk_size * ((1u << k) - 1);
+  SubscriptionSlot* chunk    = new SubscriptionSlot[size];
+  for (uint32_t i = 0; i < size; ++i) {
+    chunk[i].id_ptr.store(nullptr, std::memory_order_relaxed);
+    chunk[i].sequence.store(0, std::memory_order_relaxed);
+    chunk[i].next_free.store(first_index + i + 2, std::memory_order_relaxed);
+    chunk[i].index = first_index + i;
+  }
+  m_chunks[k].store(chunk, std::memory_order_release);
+  m_n_chunks.store(k + 1, std::memory_order_release);
+  push_free_chain(chunk[0], chunk[size - 1]);
+}
+
+inline std::vector<std::string> SubscriptionRegistry::subscribers() const {
+  std::vector<std::pair<uint64_t, const std::string*>> subscriptions;
+  const size_t n_chunks = m_n_chunks.load(std::memory_order_acquire);
+  for (size_t k = 0; k < n_chunks; ++k) {
+    const SubscriptionSlot* chunk = m_chunks[k].load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < (first_chunk_size << k); ++i) {
+      const std::string* id_ptr = chunk[i].id_ptr.load(std::memory_order_acquire);
+      if (id_ptr != nullptr) {
+        subscriptions.emplace_back(chunk[i].sequence.load(std::memory_order_relaxed),
+                                   id_ptr);
+      }
+    }
+  }
+  std::sort(std::begin(subscriptions), std::end(subscriptions));
+
+  std::vector<std::string> res;
+  res.reserve(subscriptions.size());
+  for (const auto& seq_id : subscriptions) res.push_back(*seq_id.second);
+  return res;
+}
+
+}  // namespace detail
+}  // namespace krims
@@ -0,0 +1,100 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <catch.hpp>
+#include <krims/ConcurrentGenMap.hh>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace krims {
+namespace tests {
+
+TEST_CASE("ConcurrentGenMap tests", "[genmap]") {
+  ConcurrentGenMap map{GenMap{{"a", 1}, {"b", 1}, {"tree/c", "c"}}};
+
+  SECTION("Modifications are published as new versions") {
+    ConcurrentGenMap::Reader reader(map);
+    const size_t version = map.version();
+    REQUIRE(reader.get().at<int>("a") == 1);
+
+    std::shared_ptr<const GenMap> old = map.snapshot();
+    map.modify([](GenMap& m) {
+      m.update("a", 2);
+      m.update("b", 2);
+      m.erase("tree/c");
+    });
+    REQUIRE(map.version() == version + 1);
+    REQUIRE(reader.get().at<int>("a") == 2);
+    REQUIRE(reader.get().at<int>("b") == 2);
+    REQUIRE_FALSE(reader.get().exists("tree/c"));
+
+    // Old snapshot is unchanged
+    REQUIRE(old->at<int>("a") == 1);
+    REQUIRE(old->at<std::string>("tree/c") == "c");
+
+    map.update("d", 4);
+    REQUIRE(map.version() == version + 2);
+    REQUIRE(reader.get().at<int>("d") == 4);
+    REQUIRE(reader.get().at<int>("a") == 2);
+  }
+
+  SECTION("Failing modifications are not published") {
+    const size_t version = map.version();
+    auto failing         = [](GenMap& m) {
+      m.update("a", 2);
+      throw std::runtime_error("failed");
+    };
+    REQUIRE_THROWS_AS(map.modify(failing), std::runtime_error);
+    REQUIRE(map.version() == version);
+    REQUIRE(map.snapshot()->at<int>("a") == 1);
+  }
+
+  SECTION("Readers see complete versions only") {
+    const int n_versions = 200;
+    const int n_readers  = 4;
+    std::vector<std::thread> readers;
+    std::vector<int> n_inconsistent(n_readers, 0);
+
+    for (int r = 0; r < n_readers; ++r) {
+      readers.emplace_back([&map, &n_inconsistent, r]() {
+        ConcurrentGenMap::Reader reader(map);
+        int last = 0;
+        while (last < n_versions) {
+          const GenMap& current = reader.get();
+          last                  = current.at<int>("a");
+          if (current.at<int>("b") != last) ++n_inconsistent[r];
+        }
+      });
+    }
+
+    for (int i = 2; i <= n_versions; ++i) {
+      map.modify([i](GenMap& m) {
+        m.update("a", i);
+        m.update("b", i);
+      });
+    }
+    for (auto& thread : readers) thread.join();
+
+    for (int r = 0; r < n_readers; ++r) CHECK(n_inconsistent[r] == 0);
+  }
+}
+
+}  // namespace tests
+}  // namespace krims
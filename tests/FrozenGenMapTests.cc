@@ -0,0 +1,124 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <catch.hpp>
+#include <krims/FrozenGenMap.hh>
+#include <vector>
+
+namespace krims {
+namespace tests {
+
+TEST_CASE("FrozenGenMap tests", "[genmap]") {
+  GenMap map{{"a", 1},          {"b", std::string("b")}, {"tree", "root"},
+             {"tree/i", 2},     {"tree/sub/j", 3.},      {"tree-b", 4},
+             {"treeb/value", 5}};
+  auto ptr = std::make_shared<double>(4.5);
+  map.update("ptr", ptr);
+
+  SECTION("Access to the entries") {
+    const FrozenGenMap frozen = map.freeze();
+    REQUIRE(frozen.size() == 8);
+    REQUIRE(frozen.at<int>("a") == 1);
+    REQUIRE(frozen.at<std::string>("/b") == "b");
+    REQUIRE(frozen.at<int>("tree/i") == 2);
+    REQUIRE(frozen.at<int>("/tree/./sub/../i") == 2);
+    REQUIRE(frozen.at<double>("tree//sub/j") == 3.);
+    REQUIRE(frozen.at<int>("tree-b") == 4);
+    REQUIRE(frozen.at<int>("nonexist", 42) == 42);
+    REQUIRE(frozen.at<int>("a", 42) == 1);
+    REQUIRE(frozen.type_name_of("a") == "int");
+
+    REQUIRE(frozen.exists("tree"));
+    REQUIRE(frozen.exists("tree/sub/j"));
+    REQUIRE_FALSE(frozen.exists("tree/sub"));
+    REQUIRE_FALSE(frozen.exists("c"));
+
+    REQUIRE_THROWS_AS(frozen.at<int>("c"), FrozenGenMap::ExcUnknownKey);
+    REQUIRE_THROWS_AS(frozen.at<double>("a"), FrozenGenMap::ExcWrongTypeRequested);
+
+    // Data is shared with the map
+    REQUIRE(frozen.at_ptr<double>("ptr").get() == ptr.get());
+    map.at<double>("ptr") = 5.5;
+    REQUIRE(frozen.at<double>("ptr") == 5.5);
+
+    // but not the entries themselves
+    map.update("a", 6);
+    map.erase("b");
+    REQUIRE(frozen.at<int>("a") == 1);
+    REQUIRE(frozen.exists("b"));
+  }
+
+  SECTION("Submaps of frozen maps") {
+    const FrozenGenMap frozen = map.freeze();
+    const FrozenGenMap sub    = frozen.submap("tree");
+    REQUIRE(sub.size() == 3);
+    REQUIRE(sub.at<std::string>("/") == "root");
+    REQUIRE(sub.at<int>("i") == 2);
+    REQUIRE(sub.at<double>("sub/j") == 3.);
+    REQUIRE(sub.submap("sub").at<double>("j") == 3.);
+    REQUIRE_FALSE(sub.exists("a"));
+    REQUIRE_FALSE(sub.exists("../a"));
+    REQUIRE_FALSE(sub.exists("-b"));
+    REQUIRE(frozen.submap("nonexist").empty());
+
+    // Freezing a submap of a GenMap
+    const FrozenGenMap subfrozen = map.submap("tree").freeze();
+    REQUIRE(subfrozen.size() == 3);
+    REQUIRE(subfrozen.at<int>("i") == 2);
+    REQUIRE_FALSE(subfrozen.exists("a"));
+  }
+
+  SECTION("Iterating over frozen maps") {
+    const FrozenGenMap frozen = map.freeze();
+
+    std::vector<std::string> keys;
+    for (auto it = frozen.begin(); it != frozen.end(); ++it) keys.push_back(it->key());
+    std::vector<std::string> expected{"/a",      "/b",          "/ptr",    "/tree",
+                                      "/tree/i", "/tree/sub/j", "/tree-b",
+                                      "/treeb/value"};
+    REQUIRE(keys == expected);
+
+    keys.clear();
+    for (auto it = frozen.begin("tree"); it != frozen.end("tree"); ++it) {
+      keys.push_back(it->key());
+    }
+    expected = {"/", "/i", "/sub/j"};
+    REQUIRE(keys == expected);
+
+    const FrozenGenMap sub = frozen.submap("tree");
+    keys.clear();
+    for (auto it = sub.begin("sub"); it != sub.end("sub"); ++it) {
+      keys.push_back(it->key());
+      REQUIRE(it->value<double>() == 3.);
+    }
+    expected = {"/j"};
+    REQUIRE(keys == expected);
+  }
+
+  SECTION("Empty frozen maps") {
+    const FrozenGenMap empty;
+    REQUIRE(empty.empty());
+    REQUIRE(empty.begin() == empty.end());
+    REQUIRE_FALSE(empty.exists("a"));
+    REQUIRE(GenMap{}.freeze().empty());
+  }
+}
+
+}  // namespace tests
+}  // namespace krims
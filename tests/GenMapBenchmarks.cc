@@ -0,0 +1,429 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <catch.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <krims/ConcurrentGenMap.hh>
+#include <krims/FrozenGenMap.hh>
+#include <krims/GenMap.hh>
+#include <krims/GenMapConfig.hh>
+#include <krims/GenMapGatherPlan.hh>
+#include <krims/GenMapSnapshot.hh>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The benchmarks in this file are hidden by default.
+// Run them explicitly by passing "[benchmark]" to the test executable.
+
+namespace krims {
+namespace tests {
+namespace genmap_benchmarks {
+
+/** Run the functor n_repeats times and return the average time per call
+ * in nanoseconds. */
+template <typename Functor>
+double time_per_call(size_t n_repeats, Functor&& f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n_repeats; ++i) f(i);
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / n_repeats;
+}
+
+/** Print the result of a benchmark */
+void print_timing(const std::string& description, double ns_per_call) {
+  std::cout << "    " << std::left << std::setw(50) << description << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1) << ns_per_call
+            << " ns" << std::endl;
+}
+
+/** Build a map of n_entries double values distributed over a few submaps */
+GenMap make_parameter_map(size_t n_entries) {
+  GenMap map;
+  for (size_t i = 0; i < n_entries; ++i) {
+    map.update("solver/level" + std::to_string(i % 7) + "/param" + std::to_string(i),
+               static_cast<double>(i));
+  }
+  return map;
+}
+}  // namespace genmap_benchmarks
+
+TEST_CASE("GenMap benchmarks", "[.][benchmark][genmap]") {
+  using namespace genmap_benchmarks;
+  const size_t n_entries = 10000;
+  const size_t n_repeats = 1000000;
+  GenMap map = make_parameter_map(n_entries);
+
+  SECTION("Lookup by string key versus GenMapKey") {
+    const std::string key_string = "solver/level5/param2007";
+    const GenMapKey key(key_string);
+    double sum = 0;
+
+    std::cout << "GenMap lookup of a key in a map with " << n_entries << " entries"
+              << std::endl;
+    print_timing("at<double>(std::string)", time_per_call(n_repeats, [&](size_t) {
+                   sum += map.at<double>(key_string);
+                 }));
+    print_timing("at<double>(GenMapKey)", time_per_call(n_repeats, [&](size_t) {
+                   sum += map.at<double>(key);
+                 }));
+    CHECK(sum == 2 * n_repeats * 2007.);
+  }
+
+  SECTION("Lookup in a GenMap versus a FrozenGenMap") {
+    const FrozenGenMap frozen = map.freeze();
+    const GenMap& cmap        = map;
+    double sum                = 0;
+
+    // Cycle through different keys to avoid measuring a single cached path
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < n_entries; i += 97) {
+      keys.push_back("solver/level" + std::to_string(i % 7) + "/param" +
+                     std::to_string(i));
+    }
+
+    std::cout << "Lookup of keys in a map with " << n_entries << " entries" << std::endl;
+    print_timing("GenMap::at<double>", time_per_call(n_repeats, [&](size_t i) {
+                   sum += cmap.at<double>(keys[i % keys.size()]);
+                 }));
+    print_timing("FrozenGenMap::at<double>", time_per_call(n_repeats, [&](size_t i) {
+                   sum += frozen.at<double>(keys[i % keys.size()]);
+                 }));
+    CHECK(sum > 0);
+  }
+
+  SECTION("Insertion and reading of numeric values") {
+    const size_t n_insert_repeats = 100;
+    double sum                    = 0;
+
+    std::cout << "GenMap with " << n_entries << " double entries" << std::endl;
+    print_timing("make_parameter_map (per entry)",
+                 time_per_call(n_insert_repeats, [&](size_t) {
+                   sum += make_parameter_map(n_entries).at<double>(
+                         "solver/level1/param1");
+                 }) / n_entries);
+    print_timing("Iteration and value<double>() (per entry)",
+                 time_per_call(n_insert_repeats, [&](size_t) {
+                   for (auto& kv : map) sum += kv.value<double>();
+                 }) / n_entries);
+    CHECK(sum > 0);
+  }
+
+  SECTION("Traversal of a map and of a submap") {
+    const size_t n_traverse_repeats = 100;
+    const GenMap& cmap              = map;
+    const GenMap sub                = cmap.submap("solver/level3");
+    size_t n_sub                    = 0;
+    for (auto it = sub.begin(); it != sub.end(); ++it) ++n_sub;
+    size_t key_chars = 0;
+    double sum       = 0;
+
+    std::cout << "GenMap traversal accessing key() and value<double>()" << std::endl;
+    print_timing("map with " + std::to_string(n_entries) + " entries (per entry)",
+                 time_per_call(n_traverse_repeats, [&](size_t) {
+                   const auto end = cmap.end();
+                   for (auto it = cmap.begin(); it != end; ++it) {
+                     key_chars += it->key().size();
+                     sum += it->value<double>();
+                   }
+                 }) / n_entries);
+    print_timing("submap with " + std::to_string(n_sub) + " entries (per entry)",
+                 time_per_call(n_traverse_repeats, [&](size_t) {
+                   const auto end = sub.end();
+                   for (auto it = sub.begin(); it != end; ++it) {
+                     key_chars += it->key().size();
+                     sum += it->value<double>();
+                   }
+                 }) / n_sub);
+    CHECK(key_chars > 0);
+    CHECK(sum > 0);
+  }
+
+  SECTION("Range of a submap") {
+    const size_t n_range_repeats = n_repeats / 10;
+    const GenMap& cmap           = map;
+    size_t count                 = 0;
+
+    std::cout << "GenMap range of a submap with " << n_entries / 7
+              << " entries in a map with " << n_entries << " entries" << std::endl;
+    print_timing("end(path)", time_per_call(n_range_repeats, [&](size_t) {
+                   count += cmap.end("solver/level5") != cmap.end();
+                 }));
+    CHECK(count == n_range_repeats);
+  }
+
+  SECTION("Copy versus fork of a map") {
+    const size_t n_copy_repeats = 100;
+    size_t count                = 0;
+
+    std::cout << "GenMap copy of a map with " << n_entries << " entries" << std::endl;
+    print_timing("Copy constructor", time_per_call(n_copy_repeats, [&](size_t) {
+                   GenMap copy(map);
+                   count += copy.exists("solver/level5/param2007");
+                 }));
+    print_timing("fork()", time_per_call(n_copy_repeats, [&](size_t) {
+                   GenMap copy = map.fork();
+                   count += copy.exists("solver/level5/param2007");
+                 }));
+    print_timing("fork() of submap and update",
+                 time_per_call(n_copy_repeats, [&](size_t) {
+                   GenMap copy = map.submap("solver/level5").fork();
+                   copy.update("param2007", 1.);
+                   count += copy.exists("param2007");
+                 }));
+    CHECK(count == 3 * n_copy_repeats);
+  }
+
+  SECTION("Loading a map from a snapshot") {
+    const size_t n_load_repeats = 20;
+    const std::string file      = "temp_genmap_benchmark.bin";
+    write_genmap_snapshot(map, file);
+    double sum = 0;
+
+    std::cout << "Loading a map with " << n_entries << " entries" << std::endl;
+    print_timing("update of each key", time_per_call(n_load_repeats, [&](size_t) {
+                   sum += make_parameter_map(n_entries).at<double>(
+                         "solver/level1/param1");
+                 }));
+    print_timing("read_genmap_snapshot", time_per_call(n_load_repeats, [&](size_t) {
+                   sum += read_genmap_snapshot(file).at<double>("solver/level1/param1");
+                 }));
+    print_timing("mmap_genmap_snapshot", time_per_call(n_load_repeats, [&](size_t) {
+                   sum += mmap_genmap_snapshot(file).at<double>("solver/level1/param1");
+                 }));
+    std::remove(file.c_str());
+
+    const std::string config_file = "temp_genmap_benchmark.ini";
+    {
+      std::ofstream out(config_file);
+      out.precision(17);
+      for (auto it = map.cbegin(); it != map.cend(); ++it) {
+        out << it->key() << " = " << std::showpoint << it->value<double>() << '\n';
+      }
+    }
+    print_timing("read_genmap_config", time_per_call(n_load_repeats, [&](size_t) {
+                   sum += read_genmap_config(config_file).at<double>(
+                         "solver/level1/param1");
+                 }));
+    std::remove(config_file.c_str());
+    CHECK(sum == 4 * n_load_repeats * 1.);
+  }
+
+  SECTION("Fingerprints of a map") {
+    const size_t n_fp_repeats = 100;
+    size_t count              = 0;
+
+    std::cout << "Fingerprint of a map with " << n_entries << " entries" << std::endl;
+    print_timing("fingerprint of a fresh copy", time_per_call(n_fp_repeats, [&](size_t) {
+                   count += GenMap(map).fingerprint().low != 0;
+                 }));
+    print_timing("fingerprint after update", time_per_call(n_fp_repeats, [&](size_t i) {
+                   map.update("solver/level3/param3", static_cast<double>(i));
+                   count += map.fingerprint().low != 0;
+                 }));
+    print_timing("repeated fingerprint", time_per_call(n_repeats, [&](size_t) {
+                   count += map.fingerprint().low != 0;
+                 }));
+    CHECK(count > 0);
+  }
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  SECTION("Building and destroying small maps") {
+    const size_t n_task_entries = 100;
+    const size_t n_task_repeats = 10000;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < n_task_entries; ++i) {
+      keys.push_back("task/level" + std::to_string(i % 3) + "/p" + std::to_string(i));
+    }
+    double sum = 0;
+
+    std::cout << "Building and destroying a map with " << n_task_entries << " entries"
+              << std::endl;
+    print_timing("default heap", time_per_call(n_task_repeats, [&](size_t) {
+                   GenMap task;
+                   for (const auto& key : keys) task.update_emplace<double>(key, 1.);
+                   sum += task.at<double>(keys[0]);
+                 }));
+    std::vector<char> buffer(64 * 1024);
+    print_timing("monotonic arena", time_per_call(n_task_repeats, [&](size_t) {
+                   GenMap task(std::make_shared<std::pmr::monotonic_buffer_resource>(
+                         buffer.data(), buffer.size()));
+                   for (const auto& key : keys) task.update_emplace<double>(key, 1.);
+                   sum += task.at<double>(keys[0]);
+                 }));
+    CHECK(sum == 2. * n_task_repeats);
+  }
+#endif
+
+  SECTION("Gathering the values of a subtree") {
+    const size_t n_gather_repeats = 1000;
+    const std::string path        = "solver/level3";
+    GenMapGatherPlan<double> plan(map, path);
+    std::vector<double> values(plan.size());
+    double sum = 0;
+
+    std::cout << "Gathering " << values.size() << " doubles from a map with " << n_entries
+              << " entries" << std::endl;
+    print_timing("iteration and push_back", time_per_call(n_gather_repeats, [&](size_t) {
+                   std::vector<double> res;
+                   for (const auto& kv : map.submap(path)) {
+                     res.push_back(kv.value<double>());
+                   }
+                   sum += res[0];
+                 }));
+    print_timing("GenMap::gather", time_per_call(n_gather_repeats, [&](size_t) {
+                   map.gather(path, values.data(), values.size());
+                   sum += values[0];
+                 }));
+    print_timing("GenMapGatherPlan::gather", time_per_call(n_gather_repeats, [&](size_t) {
+                   plan.gather(values.data(), values.size());
+                   sum += values[0];
+                 }));
+    CHECK(sum > 0);
+  }
+
+  SECTION("Default-filling of parameters") {
+    const size_t n_fill_repeats = 1000;
+    const size_t n_defaults     = 50;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < n_defaults; ++i) {
+      keys.push_back("solver/level" + std::to_string(i % 7) + "/default" +
+                     std::to_string(i));
+    }
+    double sum = 0;
+
+    // Fresh task maps with half of the defaults present,
+    // such that only the filling itself is timed.
+    std::vector<GenMap> tasks;
+    auto make_tasks = [&] {
+      tasks.assign(n_fill_repeats, GenMap{});
+      for (GenMap& task : tasks) {
+        for (size_t i = 0; i < n_defaults; i += 2) task.update(keys[i], 1.);
+      }
+    };
+
+    std::cout << "Filling " << n_defaults << " defaults, half of them present"
+              << std::endl;
+    make_tasks();
+    print_timing("exists and update_copy", time_per_call(n_fill_repeats, [&](size_t i) {
+                   for (const std::string& key : keys) {
+                     if (!tasks[i].exists(key)) tasks[i].update_copy(key, 2.);
+                   }
+                 }));
+    make_tasks();
+    print_timing("try_emplace", time_per_call(n_fill_repeats, [&](size_t i) {
+                   for (const std::string& key : keys) {
+                     tasks[i].try_emplace<double>(key, 2.);
+                   }
+                 }));
+    make_tasks();
+    const double fallback = 2.;
+    print_timing("at with default and update",
+                 time_per_call(n_fill_repeats, [&](size_t i) {
+                   for (const std::string& key : keys) {
+                     tasks[i].update(key, tasks[i].at(key, fallback));
+                   }
+                 }));
+    make_tasks();
+    print_timing("get_or_insert", time_per_call(n_fill_repeats, [&](size_t i) {
+                   for (const std::string& key : keys) {
+                     sum += tasks[i].get_or_insert<double>(key, [] { return 2.; }).first;
+                   }
+                 }));
+    CHECK(sum > 0);
+  }
+
+  SECTION("Merge of two maps") {
+    const size_t n_merge_repeats = 20;
+    const GenMap other           = make_parameter_map(n_entries);
+    double sum                   = 0;
+
+    std::cout << "GenMap merge of maps with " << n_entries << " entries" << std::endl;
+    print_timing("update(GenMap) into an empty map",
+                 time_per_call(n_merge_repeats, [&](size_t) {
+                   GenMap target;
+                   target.update("sub", other);
+                   sum += target.at<double>("sub/solver/level1/param1");
+                 }));
+    print_timing("update(GenMap) into an identical map",
+                 time_per_call(n_merge_repeats, [&](size_t) {
+                   GenMap target(map);
+                   target.update(other);
+                   sum += target.at<double>("solver/level1/param1");
+                 }));
+    print_timing("Copy constructor (for reference)",
+                 time_per_call(n_merge_repeats, [&](size_t) {
+                   GenMap target(map);
+                   sum += target.at<double>("solver/level1/param1");
+                 }));
+    CHECK(sum == 3 * n_merge_repeats);
+  }
+
+  SECTION("Concurrent reads: global mutex versus ConcurrentGenMap") {
+    const size_t n_reads  = n_repeats / 10;
+    const std::string key = "solver/level5/param2007";
+    ConcurrentGenMap cmap(map);
+    std::mutex mutex;
+
+    // Run the functor in n_threads threads and return the
+    // number of reads per microsecond.
+    auto throughput = [&](size_t n_threads, std::function<double()> reads) {
+      std::vector<std::thread> threads;
+      std::vector<double> sums(n_threads, 0);
+      const auto start = std::chrono::steady_clock::now();
+      for (size_t t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&sums, &reads, t] { sums[t] = reads(); });
+      }
+      for (auto& thread : threads) thread.join();
+      const auto end = std::chrono::steady_clock::now();
+      for (double sum : sums) CHECK(sum == n_reads * 2007.);
+      return n_threads * n_reads /
+             std::chrono::duration<double, std::micro>(end - start).count();
+    };
+
+    std::cout << "GenMap concurrent reads (reads per microsecond)" << std::endl;
+    for (size_t n_threads : {1, 2, 4, 8}) {
+      const double locked = throughput(n_threads, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < n_reads; ++i) {
+          std::lock_guard<std::mutex> lock(mutex);
+          sum += map.at<double>(key);
+        }
+        return sum;
+      });
+      const double lockfree = throughput(n_threads, [&] {
+        ConcurrentGenMap::Reader reader(cmap);
+        double sum = 0;
+        for (size_t i = 0; i < n_reads; ++i) sum += reader.get().at<double>(key);
+        return sum;
+      });
+      std::cout << "    " << n_threads << " threads:   mutex " << std::fixed
+                << std::setprecision(2) << std::setw(8) << locked
+                << "   ConcurrentGenMap " << std::setw(8) << lockfree << std::endl;
+    }
+  }
+}
+
+}  // namespace tests
+}  // namespace krims
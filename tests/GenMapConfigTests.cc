@@ -0,0 +1,111 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <krims/GenMapConfig.hh>
+
+namespace krims {
+namespace tests {
+
+TEST_CASE("GenMap config tests", "[genmap]") {
+  SECTION("Parse values of different types") {
+    const std::string text =
+          "# A comment\n"
+          "verbose = true\n"
+          "\n"
+          "[solver]\n"
+          "  tolerance = 1e-6   # trailing comment\n"
+          "max_iter=100\n"
+          "big = 10000000000\n"
+          "shift = +2.5\n"
+          "method = davidson dense\n"
+          "quoted = \"a \\\"b\\\" # c\\n\"  # comment\n"
+          "verbatim = 'x\\y'\n"
+          "empty =\n"
+          "; Another comment\n"
+          "[solver/level1]  \r\n"
+          "param = -3\n"
+          "[ ]\n"
+          "flag = false\n";
+    const GenMap map = parse_genmap_config(text);
+
+    CHECK(map.at<bool>("verbose") == true);
+    CHECK(map.at<double>("solver/tolerance") == 1e-6);
+    CHECK(map.at<int>("solver/max_iter") == 100);
+    CHECK(map.at<long>("solver/big") == 10000000000l);
+    CHECK(map.at<double>("solver/shift") == 2.5);
+    CHECK(map.at<std::string>("solver/method") == "davidson dense");
+    CHECK(map.at<std::string>("solver/quoted") == "a \"b\" # c\n");
+    CHECK(map.at<std::string>("solver/verbatim") == "x\\y");
+    CHECK(map.at<std::string>("solver/empty") == "");
+    CHECK(map.at<int>("solver/level1/param") == -3);
+    CHECK(map.at<bool>("flag") == false);
+
+    size_t count = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) ++count;
+    CHECK(count == 11);
+  }
+
+  SECTION("Unsorted and repeated keys") {
+    const GenMap map = parse_genmap_config(
+          "[b]\nz = 1\na = 2\n[a]\nx = 3\n[b]\nz = 4\n[b/../c]\n./y/../w = 5\n");
+    CHECK(map.at<int>("b/z") == 4);
+    CHECK(map.at<int>("b/a") == 2);
+    CHECK(map.at<int>("a/x") == 3);
+    CHECK(map.at<int>("c/w") == 5);
+
+    std::vector<std::string> keys;
+    for (auto& kv : map) keys.push_back(kv.key());
+    CHECK(keys == (std::vector<std::string>{"/a/x", "/b/a", "/b/z", "/c/w"}));
+  }
+
+  SECTION("Read config files") {
+    const std::string file = "temp_genmap_config.ini";
+    {
+      std::ofstream out(file);
+      out << "[tree]\nvalue = 1.5\nname = 'krims'\n";
+    }
+    const GenMap map = read_genmap_config(file);
+    CHECK(map.at<double>("tree/value") == 1.5);
+    CHECK(map.at<std::string>("tree/name") == "krims");
+    std::remove(file.c_str());
+
+    { std::ofstream out(file); }
+    const GenMap empty = read_genmap_config(file);
+    CHECK(empty.begin() == empty.end());
+    std::remove(file.c_str());
+
+    CHECK_THROWS_AS(read_genmap_config(file), ExcFileNotOpen);
+  }
+
+  SECTION("Syntax errors") {
+    CHECK_THROWS_AS(parse_genmap_config("[section\n"), ExcConfigSyntaxError);
+    CHECK_THROWS_AS(parse_genmap_config("[section] a\n"), ExcConfigSyntaxError);
+    CHECK_THROWS_AS(parse_genmap_config("a = 1\nkey\n"), ExcConfigSyntaxError);
+    CHECK_THROWS_AS(parse_genmap_config(" = 1\n"), ExcConfigSyntaxError);
+    CHECK_THROWS_AS(parse_genmap_config("a = \"open\n"), ExcConfigSyntaxError);
+    CHECK_THROWS_AS(parse_genmap_config("a = \"x\" y\n"), ExcConfigSyntaxError);
+    CHECK_THROWS_AS(parse_genmap_config("a = \"\\q\"\n"), ExcConfigSyntaxError);
+  }
+}
+
+}  // namespace tests
+}  // namespace krims
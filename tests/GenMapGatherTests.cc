@@ -0,0 +1,121 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <catch.hpp>
+#include <krims/GenMapGatherPlan.hh>
+#include <type_traits>
+#include <vector>
+
+namespace krims {
+namespace tests {
+
+TEST_CASE("GenMap gather and scatter tests", "[genmap]") {
+  GenMap map{{"grid/weights/0", 0.5}, {"grid/weights/1", 1.5}, {"grid/weights/2", 2.5},
+             {"grid/weights-b", 7.}, {"grid/n", 3}};
+
+  SECTION("Gather and scatter via the GenMap") {
+    std::vector<double> w(3);
+    map.gather("grid/weights", w.data(), w.size());
+    REQUIRE(w == std::vector<double>({0.5, 1.5, 2.5}));
+
+    // Via a submap and for a single entry
+    double x = 0;
+    map.submap("grid").gather("weights-b", &x, 1);
+    REQUIRE(x == 7.);
+
+    const std::vector<double> neww{3., 4., 5.};
+    map.scatter("/grid/weights/", neww.data(), neww.size());
+    REQUIRE(map.at<double>("grid/weights/0") == 3.);
+    REQUIRE(map.at<double>("grid/weights/2") == 5.);
+
+    // Sizes and types need to agree
+    REQUIRE_THROWS_AS(map.gather("grid/weights", w.data(), 2), ExcSizeMismatch);
+    REQUIRE_THROWS_AS(map.gather("grid/weights", w.data(), 4), ExcSizeMismatch);
+    REQUIRE_THROWS_AS(map.scatter("grid/weights", neww.data(), 2), ExcSizeMismatch);
+    REQUIRE(map.at<double>("grid/weights/0") == 3.);
+    REQUIRE(map.at<double>("grid/weights/1") == 4.);
+    REQUIRE_THROWS_AS(map.gather("grid", w.data(), w.size()),
+                      GenMap::ExcWrongTypeRequested);
+    map.gather("nonexistent", w.data(), 0);
+
+    // A failing scatter leaves all values unchanged
+    map.update("grid/weights/3", 1);
+    const std::vector<double> four{6., 7., 8., 9.};
+    REQUIRE_THROWS_AS(map.scatter("grid/weights", four.data(), four.size()),
+                      GenMap::ExcWrongTypeRequested);
+    REQUIRE(map.at<double>("grid/weights/0") == 3.);
+    REQUIRE(map.at<double>("grid/weights/2") == 5.);
+  }
+
+  SECTION("Gather and scatter via a plan") {
+    GenMapGatherPlan<double> plan(map, "grid/weights");
+    REQUIRE(plan.size() == 3);
+    REQUIRE(plan.is_current());
+
+    std::vector<double> w(plan.size());
+    plan.gather(w.data(), w.size());
+    REQUIRE(w == std::vector<double>({0.5, 1.5, 2.5}));
+
+    w[1] = 10.;
+    const GenMapFingerprint fingerprint = map.fingerprint("grid");
+    plan.scatter(w.data(), w.size());
+    REQUIRE(map.at<double>("grid/weights/1") == 10.);
+    REQUIRE(map.fingerprint("grid") != fingerprint);
+
+    // Modifying the values only does not invalidate the plan
+    map.at<double>("grid/weights/0") = -1.;
+    REQUIRE(plan.is_current());
+    plan.gather(w.data(), w.size());
+    REQUIRE(w[0] == -1.);
+
+    // Inserting, updating or erasing entries does
+    map.update("grid/weights/3", 3.5);
+    REQUIRE_FALSE(plan.is_current());
+    REQUIRE(plan.size() == 4);
+    w.resize(4);
+    plan.gather(w.data(), w.size());
+    REQUIRE(w == std::vector<double>({-1., 10., 2.5, 3.5}));
+
+    map.update("grid/weights/1", 1.);
+    map.erase("grid/weights/3");
+    w.resize(3);
+    plan.gather(w.data(), w.size());
+    REQUIRE(w == std::vector<double>({-1., 1., 2.5}));
+    REQUIRE_THROWS_AS(plan.gather(w.data(), 2), ExcSizeMismatch);
+
+    // Wrong types are reported on use
+    map.update("grid/weights/1", 1);
+    REQUIRE_THROWS_AS(plan.gather(w.data(), w.size()), GenMap::ExcWrongTypeRequested);
+  }
+
+  SECTION("Gather via a plan for a const map") {
+    static_assert(!std::is_constructible<GenMapGatherPlan<double>, const GenMap&,
+                                         const std::string&>::value,
+                  "Plans which scatter cannot be made from a const map.");
+
+    const GenMap& cmap = map;
+    GenMapGatherPlan<const double> plan(cmap, "grid/weights");
+    std::vector<double> w(plan.size());
+    plan.gather(w.data(), w.size());
+    REQUIRE(w == std::vector<double>({0.5, 1.5, 2.5}));
+  }
+}
+
+}  // namespace tests
+}  // namespace krims
@@ -0,0 +1,85 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <catch.hpp>
+#include <krims/GenMapSchema.hh>
+
+namespace krims {
+namespace tests {
+
+TEST_CASE("GenMap schema tests", "[genmap]") {
+  constexpr auto schema =
+        make_genmap_schema(genmap_field<double>("tolerance"),
+                           genmap_field<int>("max_iter"),
+                           genmap_field<const std::string>("method/name"));
+  static_assert(decltype(schema)::size() == 3, "Schema should have three fields");
+
+  GenMap map{{"solver/tolerance", 1e-6},
+             {"solver/max_iter", 100},
+             {"solver/method/name", std::string("cg")},
+             {"other", 3}};
+
+  SECTION("Access the fields via the handle") {
+    GenMap solver = map.submap("solver");
+    REQUIRE(schema.mismatches(solver).empty());
+
+    auto handle = schema.bind(solver);
+    REQUIRE(handle.is_current());
+    REQUIRE(handle.get<0>() == 1e-6);
+    REQUIRE(handle.get<1>() == 100);
+    REQUIRE(handle.get<2>() == "cg");
+
+    // Values modified via the handle are modified in the map
+    handle.get<1>() = 200;
+    REQUIRE(map.at<int>("solver/max_iter") == 200);
+    map.at<double>("solver/tolerance") = 1e-8;
+    REQUIRE(handle.get<0>() == 1e-8);
+    REQUIRE(handle.is_current());
+
+    // Binding via a const map gives read-only access
+    const GenMap& csolver = solver;
+    auto chandle          = schema.bind(csolver);
+    static_assert(std::is_same<decltype(chandle.get<0>()), const double&>::value,
+                  "Handle of a const map should only give const access");
+    REQUIRE(chandle.get<1>() == 200);
+
+    // Inserting entries invalidates the handle
+    map.update("solver/other", 4);
+    REQUIRE_FALSE(handle.is_current());
+    REQUIRE(schema.bind(solver).is_current());
+  }
+
+  SECTION("Report all mismatching keys") {
+    map.update("solver/max_iter", 1.5);
+    map.erase("solver/method/name");
+
+    const std::vector<std::string> errors = schema.mismatches(map.submap("solver"));
+    REQUIRE(errors.size() == 2);
+    REQUIRE(errors[0].find("/solver/max_iter") != std::string::npos);
+    REQUIRE(errors[0].find("double") != std::string::npos);
+    REQUIRE(errors[1].find("/solver/method/name") != std::string::npos);
+
+    GenMap solver = map.submap("solver");
+    REQUIRE_THROWS_AS(schema.bind(solver), decltype(schema)::ExcSchemaMismatch);
+    REQUIRE(schema.mismatches(map).size() == 3);
+  }
+}
+
+}  // namespace tests
+}  // namespace krims
@@ -0,0 +1,151 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <catch.hpp>
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <krims/GenMapSnapshot.hh>
+
+#ifdef KRIMS_HAVE_POSIX_SHM
+#include <unistd.h>
+#endif
+
+namespace krims {
+namespace tests {
+
+namespace {
+void check_snapshot_map(const GenMap& map) {
+  CHECK(map.at<std::string>("/") == "root");
+  CHECK(map.at<int>("a") == -1);
+  CHECK(map.at<double>("tree/b") == 1.5);
+  CHECK(map.at<bool>("tree/flag") == true);
+  CHECK(map.at<unsigned long>("tree/sub/c") == 42ul);
+  CHECK(map.at<std::complex<double>>("z") == std::complex<double>(1., -2.));
+  CHECK(map.at<std::string>("name") == "krims");
+  CHECK(map.at<std::string>("empty") == "");
+  CHECK(map.at<std::vector<double>>("vec") == std::vector<double>{1., 2., 3.});
+  CHECK(map.at<std::vector<int>>("vec_empty").empty());
+  CHECK(map.at<long double>("ld") == 0.25l);
+  CHECK(map.exists("tree-b"));
+}
+}  // namespace
+
+TEST_CASE("GenMap snapshot tests", "[genmap]") {
+  const std::string file = "temp_genmap_snapshot.bin";
+  GenMap map{{"/", "root"},
+             {"a", -1},
+             {"tree/b", 1.5},
+             {"tree/flag", true},
+             {"tree/sub/c", 42ul},
+             {"tree-b", 'x'},
+             {"z", std::complex<double>(1., -2.)},
+             {"name", "krims"},
+             {"empty", ""},
+             {"vec", std::vector<double>{1., 2., 3.}},
+             {"vec_empty", std::vector<int>{}},
+             {"ld", 0.25l}};
+
+  SECTION("Write and read snapshots") {
+    write_genmap_snapshot(map, file);
+
+    const GenMap read = read_genmap_snapshot(file);
+    check_snapshot_map(read);
+    std::vector<std::string> keys, ref;
+    for (auto& kv : read) keys.push_back(kv.key());
+    for (auto& kv : map) ref.push_back(kv.key());
+    CHECK(keys == ref);
+
+    GenMap mapped = mmap_genmap_snapshot(file);
+    check_snapshot_map(mapped);
+
+    // Values may be modified, but the file stays untouched
+    mapped.at<double>("tree/b") = 3.5;
+    mapped.update("a", 5);
+    CHECK(mapped.at<double>("tree/b") == 3.5);
+    CHECK(mmap_genmap_snapshot(file).at<double>("tree/b") == 1.5);
+
+    // The mapped memory stays alive as long as values refer to it
+    auto ptr = mmap_genmap_snapshot(file).at_ptr<unsigned long>("tree/sub/c");
+    CHECK(*ptr == 42ul);
+
+    std::remove(file.c_str());
+  }
+
+  SECTION("Snapshots of submaps") {
+    write_genmap_snapshot(map.submap("tree"), file);
+    const GenMap read = mmap_genmap_snapshot(file);
+    CHECK(read.at<double>("b") == 1.5);
+    CHECK(read.at<unsigned long>("sub/c") == 42ul);
+    CHECK_FALSE(read.exists("a"));
+    CHECK_FALSE(read.exists("/"));
+    std::remove(file.c_str());
+  }
+
+  SECTION("Unsupported values and invalid files") {
+    GenMap other{{"ptr", std::make_shared<std::vector<std::string>>()}};
+    CHECK_THROWS_AS(write_genmap_snapshot(other, file), ExcUnsupportedSnapshotValue);
+    std::remove(file.c_str());
+
+    // Enums cannot be restored, since their type is not known on reading
+    enum class Colour { RED, GREEN };
+    GenMap with_enum{{"colour", Colour::GREEN}};
+    CHECK_THROWS_AS(write_genmap_snapshot(with_enum, file), ExcUnsupportedSnapshotValue);
+    std::remove(file.c_str());
+
+    {
+      std::ofstream out(file);
+      out << "no snapshot, but a file large enough to hold a header of 64 bytes......";
+    }
+    CHECK_THROWS_AS(read_genmap_snapshot(file), ExcInvalidBinaryFile);
+    CHECK_THROWS_AS(mmap_genmap_snapshot(file), ExcInvalidBinaryFile);
+    std::remove(file.c_str());
+
+    CHECK_THROWS_AS(read_genmap_snapshot(file), ExcFileNotOpen);
+    CHECK_THROWS_AS(mmap_genmap_snapshot(file), ExcFileNotOpen);
+  }
+
+#ifdef KRIMS_HAVE_POSIX_SHM
+  SECTION("Snapshots in shared memory") {
+    const std::string name = "/krims_test_" + std::to_string(getpid());
+    unlink_genmap_snapshot(name);  // Left over from a failed run
+    share_genmap_snapshot(map, name);
+    CHECK_THROWS_AS(share_genmap_snapshot(map, name), ExcFileNotOpen);
+
+    GenMap attached = attach_genmap_snapshot(name);
+    GenMap attached2 = attach_genmap_snapshot(name);
+    check_snapshot_map(attached);
+    CHECK(attached.fingerprint() == map.fingerprint());
+
+    // Modifications stay in the process (and the map)
+    attached.at<int>("a") = 5;
+    CHECK(attached2.at<int>("a") == -1);
+    CHECK(attach_genmap_snapshot(name).at<int>("a") == -1);
+
+    // Attached maps stay valid after the object has been removed
+    CHECK(unlink_genmap_snapshot(name));
+    CHECK_FALSE(unlink_genmap_snapshot(name));
+    CHECK_THROWS_AS(attach_genmap_snapshot(name), ExcFileNotOpen);
+    CHECK(attached2.at<double>("tree/b") == 1.5);
+  }
+#endif
+}
+
+}  // namespace tests
+}  // namespace krims
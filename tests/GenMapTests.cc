@@ -19,8 +19,14 @@
 
 #include <catch.hpp>
 #include <krims/GenMap.hh>
+#include <krims/GenMapStatistics.hh>
 #include <krims/config.hh>
 #include <rapidcheck.h>
+#include <sstream>
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+#include <memory_resource>
+#endif
 
 namespace krims {
 namespace tests {
@@ -60,11 +66,10 @@ TEST_CASE("GenMap tests", "[genmap]") {
     REQUIRE(m.at<DummySubscribable<double>>("dummy") == dum);
   }
 
-    //
-    // ---------------------------------------------------------------
-    //
+  //
+  // ---------------------------------------------------------------
+  //
 
-#ifdef DEBUG
   SECTION("Check that type safety is assured") {
     // Add data to map.
     GenMap m{};
@@ -78,6 +83,17 @@ TEST_CASE("GenMap tests", "[genmap]") {
     REQUIRE_THROWS_AS(m.at<double>("dum"), GenMap::ExcWrongTypeRequested);
     REQUIRE(m.at<DummySubscribable<double>>("dum") == dum);
     REQUIRE(m.at<const DummySubscribable<double>>("dum") == dum);
+    REQUIRE_THROWS_AS(m.at_ptr<float>("i"), GenMap::ExcWrongTypeRequested);
+    REQUIRE_THROWS_AS(m.at<double>("i", 3.), GenMap::ExcWrongTypeRequested);
+
+    const GenMap& cm = m;
+    REQUIRE_THROWS_AS(cm.at<float>("i"), GenMap::ExcWrongTypeRequested);
+    REQUIRE(cm.at<const int>("i") == i);
+
+#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER
+    REQUIRE(m.type_name_of("i") == "int");
+    REQUIRE(m.type_name_of("i") == m.at_raw_value("i").type_name());
+#endif
   }
 
   //
@@ -98,6 +114,7 @@ TEST_CASE("GenMap tests", "[genmap]") {
   // ---------------------------------------------------------------
   //
 
+#ifdef DEBUG
   SECTION("Check for Getting the shared pointer back.") {
     // Add data to map.
     GenMap m{};
@@ -154,6 +171,38 @@ TEST_CASE("GenMap tests", "[genmap]") {
 
     REQUIRE(m.at<double>("double") == *dptr);
     REQUIRE(m.at<DummySubscribable<double>>("rcp") == dum);
+
+    // The data is shared with the pointers
+    *dptr = 4.5;
+    REQUIRE(m.at<double>("double") == 4.5);
+    REQUIRE(m.at_ptr<double>("double").get() == dptr.get());
+    REQUIRE(&m.at<DummySubscribable<double>>("rcp") == &dum);
+    REQUIRE(m.at_ptr<DummySubscribable<double>>("rcp").get() == &dum);
+
+    // Pointers to const and RCPWrappers containing shared pointers
+    auto cptr = std::make_shared<const int>(3);
+    RCPWrapper<std::string> strwrap(std::make_shared<std::string>("wrapped"));
+    m.update("const", cptr);
+    m.update("strwrap", strwrap);
+    const GenMap& cm = m;
+    REQUIRE(cm.at<int>("const") == 3);
+    REQUIRE(cm.at_ptr<int>("const").get() == cptr.get());
+    REQUIRE(m.at<std::string>("strwrap") == "wrapped");
+    REQUIRE(m.at_ptr<std::string>("strwrap").get() == strwrap.get());
+
+    // Owned subscribable objects are wrapped once on insertion, such that
+    // retrieved pointers share the same reference to the owning shared_ptr
+    auto dumown = std::make_shared<DummySubscribable<double>>(1., 2., 3., 4.);
+    m.update("dumown", dumown);
+    REQUIRE(dumown.use_count() == 2);
+    {
+      auto p1 = m.at_ptr<DummySubscribable<double>>("dumown");
+      auto p2 = cm.at_ptr<DummySubscribable<double>>("dumown");
+      REQUIRE(p1.get() == dumown.get());
+      REQUIRE(p2.get() == dumown.get());
+      REQUIRE(dumown.use_count() == 2);
+    }
+    REQUIRE(dumown.use_count() == 2);
   }
 
   //
@@ -229,6 +278,57 @@ TEST_CASE("GenMap tests", "[genmap]") {
   // ---------------------------------------------------------------
   //
 
+  SECTION("Test inserting values only if the key is missing") {
+    GenMap m{{"a/double", 3.4}, {"a/b/int", 1}};
+    GenMap sub = m.submap("a");
+    REQUIRE(sub.insert_default("/string/", std::string("blubba")));
+    REQUIRE_FALSE(sub.insert_default("double", 1.));
+    REQUIRE(m.at<std::string>("a/string") == "blubba");
+    REQUIRE(m.at<double>("a/double") == 3.4);
+
+    // try_emplace
+    REQUIRE(sub.try_emplace<std::vector<int>>("b/vector", 3, 4));
+    REQUIRE_FALSE(sub.try_emplace<int>("./b/int", 2));
+    REQUIRE(m.at<std::vector<int>>("a/b/vector") == std::vector<int>(3, 4));
+    REQUIRE(m.at<int>("a/b/int") == 1);
+
+    // get_or_insert only calls the factory if the value is inserted
+    int n_calls = 0;
+    auto factory = [&n_calls] {
+      ++n_calls;
+      return 5.;
+    };
+    auto res = sub.get_or_insert<double>("new", factory);
+    REQUIRE(res.first == 5.);
+    REQUIRE(res.second);
+    res.first = 6.;
+    REQUIRE(m.at<double>("a/new") == 6.);
+
+    auto res2 = m.get_or_insert<double>("/a/new", factory);
+    REQUIRE(res2.first == 6.);
+    REQUIRE_FALSE(res2.second);
+    REQUIRE(n_calls == 1);
+    REQUIRE_THROWS_AS(m.get_or_insert<int>("a/new", [] { return 1; }),
+                      GenMap::ExcWrongTypeRequested);
+
+    // insert_or_assign
+    REQUIRE(sub.insert_or_assign("other", 1));
+    REQUIRE_FALSE(sub.insert_or_assign("other", 2));
+    REQUIRE(m.at<int>("a/other") == 2);
+
+    // Inserting into a fork does not affect the original
+    GenMap fork = m.fork();
+    REQUIRE(fork.try_emplace<int>("a/forked", 3));
+    REQUIRE(fork.exists("a/forked"));
+    REQUIRE_FALSE(m.exists("a/forked"));
+    REQUIRE(fork.get_or_insert<double>("a/forked2", factory).second);
+    REQUIRE_FALSE(m.exists("a/forked2"));
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
   SECTION("Check basic path transformations") {
     // Add data to map.
     GenMap m{};
@@ -457,6 +557,19 @@ TEST_CASE("GenMap tests", "[genmap]") {
     }
     CHECK(itsubref == std::end(subref));
 
+    // Copies of iterators and postfix increment
+    auto itsub     = m.begin("tree");
+    auto itsubprev = itsub++;
+    CHECK(itsubprev->key() == "/");
+    CHECK(itsub->key() == "/i");
+    auto itsubcopy = itsub;
+    ++itsub;
+    CHECK(itsubcopy->key() == "/i");
+    CHECK(itsub->key() == "/sub");
+    itsubcopy = itsub;
+    CHECK((*itsubcopy).key() == "/sub");
+    CHECK(itsubprev->value<std::string>() == "root");
+
     // Iterator over empty range:
     for (auto& kv : m.submap("blubba")) {
       REQUIRE(false);  // We should never get here, since range empty
@@ -489,7 +602,7 @@ TEST_CASE("GenMap tests", "[genmap]") {
     for (auto& kv : map.submap("ints")) {
       CHECK(kv.key() == "/" + std::to_string(iref));
       CHECK(kv.value<int>() == iref);
-#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER and defined DEBUG
+#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER
       CHECK(kv.type_name() == "int");
 #endif
       ++iref;
@@ -500,7 +613,7 @@ TEST_CASE("GenMap tests", "[genmap]") {
     for (auto& kv : cmap.submap("ints")) {
       CHECK(kv.key() == "/" + std::to_string(iref));
       CHECK(kv.value<int>() == iref);
-#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER and defined DEBUG
+#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER
       CHECK(kv.type_name() == "int");
 #endif
       ++iref;
@@ -511,7 +624,7 @@ TEST_CASE("GenMap tests", "[genmap]") {
     for (auto& kv : map.submap("doubles")) {
       CHECK(kv.key() == "/pip" + std::to_string(iref));
       CHECK(kv.value<double>() == pi * iref);
-#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER and defined DEBUG
+#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER
       CHECK(kv.type_name() == "double");
 #endif
       ++iref;
@@ -522,11 +635,25 @@ TEST_CASE("GenMap tests", "[genmap]") {
     for (auto& kv : cmap.submap("doubles")) {
       CHECK(kv.key() == "/pip" + std::to_string(iref));
       CHECK(kv.value<double>() == pi * iref);
-#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER and defined DEBUG
+#if defined KRIMS_HAVE_LIBSTDCXX_DEMANGLER
       CHECK(kv.type_name() == "double");
 #endif
       ++iref;
     }
+
+    // Copies of accessors keep their key
+    std::vector<GenMapAccessor<false>> accessors;
+    for (auto kv : map.submap("ints")) accessors.push_back(kv);
+    std::vector<GenMapAccessor<true>> caccessors;
+    for (auto kv : cmap.submap("doubles")) caccessors.push_back(kv);
+    REQUIRE(accessors.size() == 9);
+    REQUIRE(caccessors.size() == 9);
+    for (int i = 0; i < 9; ++i) {
+      CHECK(accessors[i].key() == "/" + std::to_string(i));
+      CHECK(accessors[i].value<int>() == i);
+      CHECK(caccessors[i].key() == "/pip" + std::to_string(i));
+      CHECK(caccessors[i].value<double>() == pi * i);
+    }
   }  // Check accessor interface of the iterator
 
   //
@@ -665,10 +792,552 @@ TEST_CASE("GenMap tests", "[genmap]") {
     CHECK(m.at<std::string>("mapn/house/open") == "14-15");
   }
 
+  SECTION("Check updating from many entries of other maps") {
+    GenMap m;
+    GenMap n;
+    for (int j = 0; j < 100; ++j) {
+      m.update("a/" + std::to_string(j), j);
+      if (j % 3 == 0) n.update(std::to_string(j), -j);
+      if (j % 7 == 0) n.update(std::to_string(j) + "/sub", j);
+    }
+    n.update("/", -1);
+
+    m.update("a", n);
+    REQUIRE(m.at<int>("a") == -1);
+    for (int j = 0; j < 100; ++j) {
+      const std::string key = "a/" + std::to_string(j);
+      CHECK(m.at<int>(key) == (j % 3 == 0 ? -j : j));
+      CHECK(m.exists(key + "/sub") == (j % 7 == 0));
+    }
+
+    // Update from our own data
+    m.update("a/copy", m.submap("a"));
+    CHECK(m.at<int>("a/copy/3") == -3);
+    CHECK(m.at<int>("a/copy/14/sub") == 14);
+    CHECK_FALSE(m.exists("a/copy/copy"));
+
+    // Update from an rvalue
+    GenMap tmp{{"x", 1}, {"a/y", 2}, {"a/0", 3}};
+    m.update(std::move(tmp));
+    CHECK(m.at<int>("x") == 1);
+    CHECK(m.at<int>("a/y") == 2);
+    CHECK(m.at<int>("a/0") == 3);
+
+    // Rvalue submaps are copied
+    m.update("b", std::move(n.submap("0")));
+    CHECK(m.at<int>("b/sub") == 0);
+    CHECK(n.at<int>("0/sub") == 0);
+
+    // Default values from an initialiser list
+    m.insert_default({{"a/1", 10}, {"a/new", 11}, {"a/./1", 12}, {"z", 13}});
+    CHECK(m.at<int>("a/1") == 1);
+    CHECK(m.at<int>("a/new") == 11);
+    CHECK(m.at<int>("z") == 13);
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Check access using GenMapKey") {
+    GenMap m{{"tree/sub", s},   {"tree/i", i},    {"dum", dum},
+             {"tree/value", 9}, {"tree", "root"}, {"/", "god"}};
+    GenMap sub = m.submap("tree");
+
+    // Normalisation is done on construction:
+    const GenMapKey key_i("/../tree/./i/");
+    const GenMapKey key_value("value");
+    const GenMapKey key_root("/.");
+    CHECK(key_i.path() == "/tree/i");
+    CHECK(key_value.path() == "/value");
+    CHECK(key_root.path() == "");
+
+    // Repeated lookups:
+    for (int rep = 0; rep < 3; ++rep) {
+      REQUIRE(m.exists(key_i));
+      REQUIRE(m.at<int>(key_i) == i);
+      REQUIRE(sub.at<int>(key_value) == 9);
+      REQUIRE(m.at<std::string>(key_root) == "god");
+      REQUIRE(sub.at<std::string>(key_root) == "root");
+      REQUIRE_FALSE(m.exists(key_value));
+      REQUIRE(m.at<int>(key_value, i) == i);
+    }
+
+    // Modification via string keys is seen
+    m.update("tree/value", 10);
+    REQUIRE(sub.at<int>(key_value) == 10);
+
+    // Modification via GenMapKey is seen
+    sub.update(key_value, 11);
+    REQUIRE(m.at<int>("tree/value") == 11);
+
+    // Erasure invalidates the cache
+    REQUIRE(m.erase(key_i) == 1);
+    REQUIRE(m.erase(key_i) == 0);
+    REQUIRE_FALSE(m.exists(key_i));
+    REQUIRE_THROWS_AS(m.at<int>(key_i), GenMap::ExcUnknownKey);
+    m.update(key_i, 42);
+    REQUIRE(m.at<int>("tree/i") == 42);
+
+    sub.erase("value");
+    REQUIRE_FALSE(sub.exists(key_value));
+    sub.update("value", 12);
+    REQUIRE(sub.at<int>(key_value) == 12);
+
+    // Cache does not leak to copies
+    GenMap copy(m);
+    copy.update("tree/value", 13);
+    REQUIRE(copy.submap("tree").at<int>(key_value) == 13);
+    REQUIRE(sub.at<int>(key_value) == 12);
+  }
+
+  SECTION("Check lookup with normalised and non-normalised keys") {
+    GenMap m{{"tree/sub", s},  {"tree/i", i},      {"tree-a", dum},
+             {"tree/b/c", 9},  {"tree", "root"},   {"/", "god"}};
+    GenMap sub = m.submap("tree");
+
+    CHECK(GenMapKey::is_normalised(""));
+    CHECK(GenMapKey::is_normalised("/"));
+    CHECK(GenMapKey::is_normalised("tree/i"));
+    CHECK(GenMapKey::is_normalised("/tree/i"));
+    CHECK_FALSE(GenMapKey::is_normalised("tree/"));
+    CHECK_FALSE(GenMapKey::is_normalised("//tree"));
+    CHECK_FALSE(GenMapKey::is_normalised("tree/./i"));
+    CHECK_FALSE(GenMapKey::is_normalised("tree/.."));
+
+    // Both kinds of keys give the same results, from the root and a submap
+    REQUIRE(m.at<int>("tree/i") == i);
+    REQUIRE(m.at<int>("/tree/./b/../i") == i);
+    REQUIRE(sub.at<int>("b/c") == 9);
+    REQUIRE(sub.at<int>("/b/c") == 9);
+    REQUIRE(sub.at<int>("b//c") == 9);
+    REQUIRE(sub.at<std::string>("/") == "root");
+    REQUIRE(sub.at<std::string>("") == "root");
+    REQUIRE(sub.at<std::string>("..") == "root");
+    REQUIRE_FALSE(sub.exists("-a"));
+    REQUIRE_FALSE(sub.exists("b"));
+    REQUIRE(sub.at_ptr<int>("i") != nullptr);
+    REQUIRE(sub.type_name_of("b/c") == m.type_name_of("tree/b/c"));
+
+#ifdef KRIMS_HAVE_CXX17
+    const std::string_view view = "tree/b/c/d";
+    REQUIRE(m.at<int>(view.substr(0, 8)) == 9);
+    REQUIRE(sub.exists(view.substr(5, 3)));
+#endif
+
+    // insert_default and erase
+    sub.insert_default("b/c", 10);
+    sub.insert_default("b/d", 11);
+    REQUIRE(m.at<int>("tree/b/c") == 9);
+    REQUIRE(m.at<int>("tree/b/d") == 11);
+    REQUIRE(sub.erase("b/d") == 1);
+    REQUIRE(sub.erase("b/d") == 0);
+    REQUIRE_FALSE(m.exists("tree/b/d"));
+  }
+
   //
   // ---------------------------------------------------------------
   //
 
+  SECTION("Check that subtrees are separated from similar keys") {
+    GenMap m{{"a", 1},   {"a/b", 2},   {"a/c/d", 3}, {"a-b", 4},
+             {"ab", 5},  {"a.b", 6},   {"a/b-c", 7}, {"b", 8}};
+
+    std::vector<std::string> keys;
+    for (auto it = m.begin("a"); it != m.end("a"); ++it) keys.push_back(it->key());
+    std::vector<std::string> expected{"/", "/b", "/b-c", "/c/d"};
+    REQUIRE(keys == expected);
+
+    // Same for a submap
+    GenMap sub = m.submap("a");
+    keys.clear();
+    for (auto it = sub.begin(); it != sub.end(); ++it) keys.push_back(it->key());
+    REQUIRE(keys == expected);
+
+    sub.erase_recursive("b");
+    REQUIRE_FALSE(m.exists("a/b"));
+    REQUIRE(m.at<int>("a/b-c") == 7);
+
+    m.erase_recursive("a");
+    REQUIRE_FALSE(m.exists("a"));
+    REQUIRE_FALSE(m.exists("a/c/d"));
+    REQUIRE(m.at<int>("a-b") == 4);
+    REQUIRE(m.at<int>("ab") == 5);
+    REQUIRE(m.at<int>("a.b") == 6);
+    REQUIRE(m.at<int>("b") == 8);
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Check that forked maps behave like copies") {
+    GenMap m{{"tree/sub", s},   {"tree/i", i},    {"dum", dum},
+             {"tree/value", 9}, {"tree", "root"}, {"/", "god"}};
+    GenMap fork = m.fork();
+    GenMap copy(m);
+
+    // Modification of the data affects both
+    fork.at<int>("tree/value") = 10;
+    REQUIRE(m.at<int>("tree/value") == 10);
+
+    // Iterating and raw access do not copy the entries
+    const GenMapKey key("tree/value");
+    REQUIRE(fork.at<int>(key) == 10);
+    for (auto& kv : fork) (void)kv.value_raw();
+    (void)fork.at_raw_value("dum");
+    const GenMap& cfork = fork;
+    const GenMap& cm    = m;
+    REQUIRE(&cfork.at_raw_value("tree/value") == &cm.at_raw_value("tree/value"));
+    REQUIRE(fork.at<int>(key) == 10);
+
+    // Updates only affect one of them
+    fork.update("tree/value", 11);
+    REQUIRE(fork.at<int>("tree/value") == 11);
+    REQUIRE(m.at<int>("tree/value") == 10);
+    m.update("new", 1);
+    REQUIRE(m.exists("new"));
+    REQUIRE_FALSE(fork.exists("new"));
+    REQUIRE(copy.at<int>("tree/value") == 10);
+
+    // Erasure via iterator from the original after a fork
+    GenMap fork2 = m.fork();
+    auto it = m.begin("tree");
+    GenMap fork3 = m.fork();
+    it = m.erase(it);
+    REQUIRE_FALSE(m.exists("tree"));
+    REQUIRE(it->key() == "/tree/i");
+    REQUIRE(fork2.at<std::string>("tree") == "root");
+    REQUIRE(fork3.at<std::string>("tree") == "root");
+    m.erase(m.begin("tree"), m.end("tree"));
+    REQUIRE_FALSE(m.exists("tree/i"));
+    REQUIRE(fork2.at<int>("tree/i") == i);
+
+    // Forks of submaps
+    GenMap sub     = fork2.submap("tree");
+    GenMap subfork = sub.fork();
+    subfork.update("i", 3);
+    subfork.erase("sub");
+    REQUIRE(subfork.at<int>("i") == 3);
+    REQUIRE(subfork.at<std::string>("/") == "root");
+    REQUIRE(sub.at<int>("i") == i);
+    REQUIRE(sub.exists("sub"));
+    REQUIRE_FALSE(subfork.exists("sub"));
+    REQUIRE_FALSE(subfork.exists("../dum"));
+
+    std::vector<std::string> keys;
+    for (auto itsub = subfork.begin(); itsub != subfork.end(); ++itsub) {
+      keys.push_back(itsub->key());
+    }
+    std::vector<std::string> expected{"/", "/i", "/value"};
+    REQUIRE(keys == expected);
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Check fingerprints of subtrees") {
+    GenMap m{{"tree/sub/a", 1}, {"tree/sub/b", 2.5}, {"tree/s", s},
+             {"tree", "root"},  {"flag", true},     {"dum", dum}};
+    const GenMapFingerprint full = m.fingerprint();
+    const GenMapFingerprint tree = m.fingerprint("tree");
+    REQUIRE(full != tree);
+    REQUIRE(m.fingerprint() == full);
+    REQUIRE(m.submap("tree").fingerprint() == tree);
+
+    // Equal subtrees have equal fingerprints independent of their location
+    GenMap other{{"x/sub/a", 1}, {"x/sub/b", 2.5}, {"x/s", s}, {"x", "root"}};
+    REQUIRE(other.fingerprint("x") == tree);
+    REQUIRE(other.fingerprint("x/sub") == m.fingerprint("tree/sub"));
+
+    // Keys, values and types are taken into account
+    other.update("x/sub/a", 2);
+    REQUIRE(other.fingerprint("x") != tree);
+    other.update("x/sub/a", 1l);
+    REQUIRE(other.fingerprint("x") != tree);
+    other.update("x/sub/a", 1);
+    REQUIRE(other.fingerprint("x") == tree);
+    other.erase("x/sub/a");
+    other.update("x/sub/c", 1);
+    REQUIRE(other.fingerprint("x") != tree);
+    REQUIRE(GenMap{}.fingerprint() != GenMap{{"a", ""}}.fingerprint());
+    REQUIRE(GenMap{{"ab", 1}}.fingerprint() != GenMap{{"a/b", 1}}.fingerprint());
+
+    // Updates and erasure refresh the affected fingerprints only
+    const GenMapFingerprint sub = m.fingerprint("tree/sub");
+    m.update("flag", false);
+    REQUIRE(m.fingerprint() != full);
+    REQUIRE(m.fingerprint("tree") == tree);
+    m.update("tree/sub/b", 3.5);
+    REQUIRE(m.fingerprint("tree/sub") != sub);
+    REQUIRE(m.fingerprint("tree") != tree);
+    m.update("tree/sub/b", 2.5);
+    REQUIRE(m.fingerprint("tree/sub") == sub);
+    REQUIRE(m.fingerprint("tree") == tree);
+    m.erase("tree/s");
+    REQUIRE(m.fingerprint("tree") != tree);
+    REQUIRE(m.fingerprint("tree/sub") == sub);
+    m.submap("tree").update("s", s);
+    REQUIRE(m.fingerprint("tree") == tree);
+    m.erase_recursive("tree/sub");
+    REQUIRE(m.fingerprint("tree") != tree);
+    m.update("tree", GenMap{{"sub/a", 1}, {"sub/b", 2.5}});
+    REQUIRE(m.fingerprint("tree") == tree);
+
+    // Iteration keeps and erasure of ranges refreshes the affected fingerprints
+    const GenMapFingerprint updated = m.fingerprint();
+    for (auto& kv : m) (void)kv.value_raw();
+    REQUIRE(m.fingerprint() == updated);
+    m.erase(m.begin("tree/sub"), m.end("tree/sub"));
+    REQUIRE(m.fingerprint("tree") != tree);
+    REQUIRE(m.fingerprint() != updated);
+    m.update("tree", GenMap{{"sub/a", 1}, {"sub/b", 2.5}});
+    REQUIRE(m.fingerprint("tree") == tree);
+    REQUIRE(m.fingerprint() == updated);
+
+    // Forks keep their own fingerprints
+    GenMap fork = m.fork();
+    fork.update("tree/s", "other");
+    REQUIRE(fork.fingerprint("tree") != tree);
+    REQUIRE(m.fingerprint("tree") == tree);
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Check lazily computed entries") {
+    int n_calls = 0;
+    GenMap m;
+    m.update("lazy", make_lazy([&n_calls] {
+               ++n_calls;
+               return std::vector<int>{1, 2, 3};
+             }));
+    m.update("other", 5);
+    REQUIRE(m.exists("lazy"));
+    REQUIRE(m.type_name_of("lazy") ==
+            GenMap{{"v", std::make_shared<std::vector<int>>()}}.type_name_of("v"));
+    REQUIRE_FALSE(m.is_evaluated("lazy"));
+    REQUIRE(m.is_evaluated("other"));
+
+    // Neither copies nor fingerprints evaluate the entry
+    GenMap copy = m;
+    m.fingerprint();
+    REQUIRE(n_calls == 0);
+
+    // The factory is only called on the first access
+    const std::vector<int>& v = m.at<std::vector<int>>("lazy");
+    REQUIRE(v == std::vector<int>({1, 2, 3}));
+    REQUIRE(m.is_evaluated("lazy"));
+    REQUIRE(copy.is_evaluated("lazy"));
+    REQUIRE(&copy.at<const std::vector<int>>("lazy") == &v);
+    REQUIRE(*m.at_ptr<std::vector<int>>("lazy") == v);
+    REQUIRE(n_calls == 1);
+
+    // Retrieval with the wrong type does not evaluate either
+    GenMap m2{{"lazy", make_lazy([&n_calls] { return ++n_calls; })}};
+#ifdef DEBUG
+    REQUIRE_THROWS_AS(m2.at<double>("lazy"), GenMap::ExcWrongTypeRequested);
+#endif
+    REQUIRE_FALSE(m2.is_evaluated(GenMapKey("lazy")));
+    REQUIRE(m2.at<int>("lazy") == 2);
+    REQUIRE(m2.at<int>("lazy") == 2);
+
+    // A throwing factory is retried on the next access
+    bool fail = true;
+    m2.update("throws", make_lazy([&fail] {
+                assert_throw(!fail, ExcNotImplemented());
+                return std::string("ok");
+              }));
+    REQUIRE_THROWS_AS(m2.at<std::string>("throws"), ExcNotImplemented);
+    REQUIRE_FALSE(m2.is_evaluated("throws"));
+    fail = false;
+    REQUIRE(m2.at<std::string>("throws") == "ok");
+    REQUIRE(m2.is_evaluated("throws"));
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Check watching for changes") {
+    GenMap m{{"solver/tol", 1e-6}, {"solver/maxiter", 10}, {"grid/n", 5}};
+
+    std::vector<std::vector<std::string>> calls;
+    auto record        = [&calls](const std::vector<std::string>& keys) {
+      calls.push_back(keys);
+    };
+    GenMapWatch solver = m.watch("solver", record);
+    GenMapWatch grid = m.watch("/grid/");
+    GenMapWatch all  = m.watch();
+    REQUIRE(solver.is_active());
+    REQUIRE_FALSE(GenMapWatch{}.is_active());
+
+    // Changes are only delivered on flush and batched
+    m.update("solver/tol", 1e-8);
+    m.update("solver/maxiter", 100);
+    m.update("solver/tol", 1e-9);
+    REQUIRE_FALSE(solver.is_dirty());
+    REQUIRE(calls.empty());
+    m.flush();
+    REQUIRE(solver.is_dirty());
+    REQUIRE_FALSE(grid.is_dirty());
+    REQUIRE(all.is_dirty());
+    REQUIRE(calls == std::vector<std::vector<std::string>>{{"maxiter", "tol"}});
+
+    // Nothing new
+    solver.reset();
+    all.reset();
+    m.flush();
+    REQUIRE_FALSE(solver.is_dirty());
+    REQUIRE(calls.size() == 1);
+
+    // Changes via submaps, insert_default and erase
+    GenMap sub = m.submap("grid");
+    sub.update("m", 3);
+    m.insert_default("solver/tol", 1.);  // Existing, so no change
+    m.insert_default("solver/method", std::string("cg"));
+    m.erase("solver/maxiter");
+    m.flush();
+    REQUIRE(grid.is_dirty());
+    REQUIRE(calls.back() == std::vector<std::string>{"maxiter", "method"});
+    grid.reset();
+
+    // Updating from a map, clearing or erasing a parent affects the whole subtree
+    m.update("solver", GenMap{{"tol", 1e-4}});
+    m.submap("grid").clear();
+    m.flush();
+    REQUIRE(grid.is_dirty());
+    REQUIRE(calls.back() == std::vector<std::string>{""});
+    m.update("solver/a/b", 1);
+    m.update("solver/c", 1);
+    m.erase_recursive("solver/a");
+    m.flush();
+    REQUIRE(calls.back() == std::vector<std::string>{"a/b", "c"});
+    m.clear();
+    m.flush();
+    REQUIRE(calls.back() == std::vector<std::string>{""});
+
+    // Released watches and copies are not notified
+    solver.release();
+    GenMap copy = m.fork();
+    copy.update("solver/tol", 1.);
+    m.update("solver/tol", 1.);
+    copy.flush();
+    m.flush();
+    REQUIRE(calls.size() == 5);
+    REQUIRE_FALSE(solver.is_dirty());
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+#ifdef KRIMS_HAVE_MEMORY_RESOURCE
+  SECTION("Check maps allocating from an arena") {
+    // Resource counting the blocks currently allocated from it
+    struct CountingResource : public std::pmr::memory_resource {
+      size_t n_blocks = 0;
+      void* do_allocate(size_t bytes, size_t alignment) override {
+        ++n_blocks;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+      }
+      void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        --n_blocks;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+      }
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+      }
+    };
+
+    auto arena_ptr = std::make_shared<CountingResource>();
+    std::weak_ptr<CountingResource> arena_weak{arena_ptr};
+    GenMap copy;
+    {
+      GenMap m(arena_ptr);
+      m.update_emplace<double>("a/x", 1.5);
+      m.update_emplace<std::vector<int>>("a/v", 3, 4);
+      m.update_copy("b", std::string("str"));
+      m.submap("c").update_emplace<int>("i", 3);
+      REQUIRE(arena_ptr->n_blocks >= 8);  // 4 nodes and 4 values
+      REQUIRE(m.at<std::vector<int>>("a/v") == std::vector<int>(3, 4));
+      REQUIRE(m.at<int>("c/i") == 3);
+
+      // Erasing returns the memory
+      const size_t n_blocks = arena_ptr->n_blocks;
+      m.erase("b");
+      REQUIRE(arena_ptr->n_blocks == n_blocks - 2);
+
+      // Entries moved between maps in different arenas are copied
+      GenMap other;
+      other.update("d", 4);
+      m.update(std::move(other));
+      REQUIRE(m.at<int>("d") == 4);
+
+      copy = m;
+      arena_ptr.reset();
+      REQUIRE_FALSE(arena_weak.expired());
+    }
+
+    // The values of the copy still live in the arena
+    REQUIRE_FALSE(arena_weak.expired());
+    REQUIRE(copy.at<double>("a/x") == 1.5);
+    copy.clear();
+    REQUIRE(arena_weak.expired());
+  }
+#endif
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Check statistics about lookups") {
+    reset_genmap_statistics();
+    GenMap m{{"a", 1}, {"sub/b", 2}};
+    GenMap sub = m.submap("sub");
+    const GenMapKey key_b{"b"};
+
+    REQUIRE(m.at<int>("a") == 1);
+    REQUIRE(m.at<int>("/a/") == 1);
+    REQUIRE_FALSE(m.exists("c"));
+    REQUIRE(sub.at<int>("b") == 2);
+    REQUIRE(sub.at<int>(key_b) == 2);
+    REQUIRE(sub.at<int>(key_b) == 2);
+
+    std::ostringstream report;
+    print_genmap_statistics(report);
+    const std::vector<GenMapKeyStatistics> stats = genmap_statistics();
+
+    if (genmap_statistics_enabled()) {
+      auto stats_of = [&stats](const std::string& key) {
+        auto it = std::find_if(
+              std::begin(stats), std::end(stats),
+              [&key](const GenMapKeyStatistics& s) { return s.key == key; });
+        REQUIRE(it != std::end(stats));
+        return *it;
+      };
+      REQUIRE(stats_of("/a").n_lookups == 2);
+      REQUIRE(stats_of("/a").n_misses == 0);
+      REQUIRE(stats_of("/c").n_misses == 1);
+      REQUIRE(stats_of("/sub/b").n_lookups == 3);
+      REQUIRE(stats_of("/sub/b").n_cached == 1);
+      REQUIRE(std::is_sorted(std::begin(stats), std::end(stats),
+                             [](const GenMapKeyStatistics& lhs,
+                                const GenMapKeyStatistics& rhs) {
+                               return lhs.total_ns() > rhs.total_ns();
+                             }));
+      REQUIRE(report.str().find("/sub/b") != std::string::npos);
+
+      reset_genmap_statistics();
+      REQUIRE(genmap_statistics().empty());
+    } else {
+      REQUIRE(stats.empty());
+      REQUIRE(report.str().find("not collected") != std::string::npos);
+    }
+  }
+
   // TODO Test mass update from initialiser list
 
 }  // TEST_CASE
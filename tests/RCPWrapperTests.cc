@@ -121,6 +121,58 @@ TEST_CASE("RCPWrapperTests", "[RCPWrapper]") {
 #endif
   }  // RCPWrapper from shared and subscription pointers
 
+  SECTION("Ownership and subscriptions of copies") {
+    static_assert(sizeof(RCPWrapper<SimpleSubscribableChild>) == 2 * sizeof(void*),
+                  "RCPWrapper should be a pointer and a tagged pointer");
+
+    std::weak_ptr<SimpleSubscribableChild> weak{sshared};
+    {
+      RCPWrapper<SimpleSubscribableChild> ptrwrap(sshared);
+      sshared.reset();
+      RCPWrapper<const SimpleSubscribable> copy(ptrwrap);
+      RCPWrapper<SimpleSubscribableChild> assigned;
+      REQUIRE(!assigned.is_shared_ptr());
+      REQUIRE(assigned == nullptr);
+      assigned = ptrwrap;
+      ptrwrap  = RCPWrapper<SimpleSubscribableChild>{};
+      REQUIRE(!weak.expired());
+      REQUIRE(copy.is_shared_ptr());
+      REQUIRE(copy->data == 5);
+
+      // The shared pointer extracted shares the ownership
+      std::shared_ptr<const SimpleSubscribable> extracted(copy);
+      REQUIRE(extracted.get() == copy.get());
+      REQUIRE(weak.use_count() == 2);  // The control block and extracted
+      assigned = RCPWrapper<SimpleSubscribableChild>{};
+      copy     = RCPWrapper<const SimpleSubscribable>{};
+      REQUIRE(!weak.expired());
+      REQUIRE(extracted->data == 5);
+    }
+    REQUIRE(weak.expired());
+
+    // Wrapping a nullptr
+    std::shared_ptr<SimpleSubscribableChild> nullshared;
+    RCPWrapper<SimpleSubscribableChild> nullwrap(nullshared);
+    REQUIRE(nullwrap.is_shared_ptr());
+    REQUIRE(nullwrap == nullptr);
+    REQUIRE(static_cast<std::shared_ptr<SimpleSubscribableChild>>(nullwrap) == nullptr);
+
+    {
+      RCPWrapper<SimpleSubscribableChild> subwrap(ssub);
+      RCPWrapper<SimpleSubscribable> copy(subwrap);
+      RCPWrapper<SimpleSubscribableChild> moved(std::move(subwrap));
+      REQUIRE(moved.get() == &s);
+      REQUIRE(copy.get() == &s);
+#if DEBUG
+      REQUIRE(s.n_subscriptions() == 3);
+      REQUIRE(s.subscribers()[2] == "test");
+#endif
+    }
+#if DEBUG
+    REQUIRE(s.n_subscriptions() == 1);
+#endif
+  }  // Ownership and subscriptions of copies
+
 }  // TEST_CASE
 }  // namespace tests
 }  // namespace krims
@@ -0,0 +1,132 @@
+//
+// Copyright (C) 2017 by the krims authors
+//
+// This file is part of krims.
+//
+// krims is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// krims is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with krims. If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <algorithm>
+#include <array>
+#include <catch.hpp>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <krims/RCPWrapper.hh>
+#include <krims/Subscribable.hh>
+#include <krims/SubscriptionPointer.hh>
+#include <limits>
+#include <numeric>
+#include <string>
+
+// The benchmarks in this file are hidden by default.
+// Run them explicitly by passing "[benchmark]" to the test executable.
+// Comparing the timings of a RELEASE build with and without
+// KRIMS_SUBSCRIPTION_COUNTING gives the overhead of counting subscriptions.
+// Copying a SubscriptionPointer is the worst case: Without counting the copy
+// is free, with counting it is bound by the latency of updating the count
+// in memory (about 0.8 ns versus 3.4 ns per copy on the test machine).
+
+namespace krims {
+namespace tests {
+namespace subscription_benchmarks {
+
+/** Run the functor n_repeats times and return the average time per call
+ * in nanoseconds. This is repeated n_runs times and the fastest run is taken,
+ * since the differences between the modes are small compared to the noise. */
+template <typename Functor>
+double time_per_call(size_t n_runs, size_t n_repeats, Functor&& f) {
+  double best = std::numeric_limits<double>::max();
+  for (size_t run = 0; run < n_runs; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n_repeats; ++i) f(i);
+    const auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  return best / n_repeats;
+}
+
+/** Print the result of a benchmark */
+void print_timing(const std::string& description, double ns_per_call) {
+  std::cout << "    " << std::left << std::setw(50) << description << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1) << ns_per_call
+            << " ns" << std::endl;
+}
+
+/** Name of the subscription checking mode this file was compiled in */
+std::string subscription_mode() {
+#if defined(DEBUG)
+  return "DEBUG";
+#elif defined(KRIMS_SUBSCRIPTION_COUNTING)
+  return "RELEASE with KRIMS_SUBSCRIPTION_COUNTING";
+#else
+  return "RELEASE";
+#endif
+}
+
+/** A small subscribable vector */
+struct SmallVector : public Subscribable {
+  std::array<double, 64> data;
+  SmallVector() { std::iota(data.begin(), data.end(), 0.); }
+};
+
+/** A lazy operation, which keeps a reference to its argument */
+struct LazyShiftedDot {
+  RCPWrapper<const SmallVector> vector;
+  size_t shift;
+
+  /** Dot product of the vector with a cyclically shifted copy of itself */
+  double evaluate() const {
+    const auto& data = vector->data;
+    double ret       = 0;
+    for (size_t j = 0; j < data.size(); ++j) {
+      ret += data[j] * data[(j + shift) % data.size()];
+    }
+    return ret;
+  }
+};
+}  // namespace subscription_benchmarks
+
+TEST_CASE("Subscription benchmarks", "[.][benchmark][subscription]") {
+  using namespace subscription_benchmarks;
+  const size_t n_runs    = 7;
+  const size_t n_repeats = 2000000;
+  SmallVector vector;
+  const auto sptr = make_subscription(vector, "benchmark");
+  const RCPWrapper<const SmallVector> wrapper(make_subscription(vector, "benchmark"));
+  double sum = 0;
+
+  std::cout << "Subscriptions in mode " << subscription_mode() << std::endl;
+  print_timing("Copy and destroy SubscriptionPointer",
+               time_per_call(n_runs, n_repeats, [&](size_t) {
+                 SubscriptionPointer<SmallVector> copy(sptr);
+                 sum += copy->data[1];
+               }));
+  print_timing("Copy and destroy RCPWrapper",
+               time_per_call(n_runs, n_repeats, [&](size_t) {
+                 RCPWrapper<const SmallVector> copy(wrapper);
+                 sum += copy->data[1];
+               }));
+  print_timing("Build and evaluate a lazy operation",
+               time_per_call(n_runs, n_repeats, [&](size_t i) {
+                 const LazyShiftedDot op{wrapper, i % 64};
+                 sum += op.evaluate();
+               }));
+  CHECK(sum > 0);
+  CHECK(vector.data[1] == 1.);
+}
+
+}  // namespace tests
+}  // namespace krims
@@ -18,12 +18,16 @@
 //
 
 #include <catch.hpp>
+#include <krims/RCPWrapper.hh>
 #include <krims/Subscribable.hh>
 #include <krims/SubscriptionPointer.hh>
 #include <memory>
 #include <rapidcheck.h>
 #include <rapidcheck/state.h>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 // have an extra verbose output for rapidcheck function tests:
 //#define HAVE_SUBSCRIPTION_RC_CLASSIFY
@@ -481,8 +485,10 @@ struct CreateObjectPointer
     sut.pointers.push_back(
           make_subscription<SubscribableType>(sut.objects[obj_index], id));
 
-    // check the id agrees.
+#ifdef DEBUG
+    // check the id agrees (ids are only stored in DEBUG mode).
     RC_ASSERT(sut.pointers[ptr_index].subscriber_id() == id);
+#endif
 
     // Check that we point to the right thing
     RC_ASSERT(sut.pointers[ptr_index].get() == &sut.objects[obj_index]);
@@ -542,8 +548,10 @@ struct CreateEmptyPointer
 
     sut.pointers.emplace_back(id);
 
-    // check the id agrees.
+#ifdef DEBUG
+    // check the id agrees (ids are only stored in DEBUG mode).
     RC_ASSERT(sut.pointers[ptr_index].subscriber_id() == id);
+#endif
 
     // Check that we point to null:
     RC_ASSERT(sut.pointers[ptr_index].get() == nullptr);
@@ -1003,6 +1011,119 @@ TEST_CASE("Subscription and SubscriptionPointer system", "[subscription]") {
   // ---------------------------------------------------------------
   //
 
+  SECTION("Copies of SubscriptionPointers share the subscriber id") {
+    SimpleSubscribable s{};
+    auto sptr = make_subscription(s, "Test");
+    SubscriptionPointer<SimpleSubscribable> copy(sptr);
+    SubscriptionPointer<const SimpleSubscribable> converted(sptr);
+    REQUIRE(copy.get() == &s);
+    REQUIRE(converted.get() == &s);
+
+#ifdef DEBUG
+    // Equal ids are only stored once
+    REQUIRE(&copy.subscriber_id() == &sptr.subscriber_id());
+    REQUIRE(&converted.subscriber_id() == &sptr.subscriber_id());
+    REQUIRE(&make_subscription(s, "Test").subscriber_id() == &sptr.subscriber_id());
+    REQUIRE(copy.subscriber_id() == "Test");
+    REQUIRE(s.n_subscriptions() == 3);
+#else
+    // In RELEASE mode the pointer is just a raw pointer
+    static_assert(sizeof(SubscriptionPointer<SimpleSubscribable>) ==
+                        sizeof(SimpleSubscribable*),
+                  "SubscriptionPointer should be a plain pointer in RELEASE mode");
+#endif
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Many subscriptions released in arbitrary order") {
+    SimpleSubscribable s{};
+    std::vector<SubscriptionPointer<SimpleSubscribable>> ptrs;
+    for (size_t i = 0; i < 1000; ++i) {
+      ptrs.push_back(make_subscription(s, "sub" + std::to_string(i)));
+    }
+
+    // Release every third subscription, starting from the back
+    for (size_t i = ptrs.size(); i > 0; --i) {
+      if (i % 3 == 0) ptrs[i - 1].reset();
+    }
+
+    // Subscribe again, reusing the freed slots
+    auto late = make_subscription(s, "late");
+
+#ifdef DEBUG
+    REQUIRE(s.n_subscriptions() == 1000 - 333 + 1);
+    const std::vector<std::string> subscribers = s.subscribers();
+    REQUIRE(subscribers.size() == s.n_subscriptions());
+    REQUIRE(subscribers[0] == "sub0");
+    REQUIRE(subscribers[1] == "sub1");
+    REQUIRE(subscribers[2] == "sub3");
+    REQUIRE(subscribers.back() == "late");
+#endif
+
+    ptrs.clear();
+    late.reset();
+#ifdef DEBUG
+    REQUIRE(s.n_subscriptions() == 0);
+#endif
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+  SECTION("Subscribing and unsubscribing from many threads") {
+    SimpleSubscribable s{};
+    auto sptr = make_subscription(s, "main");
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+      threads.emplace_back([&sptr, t] {
+        const std::string id = "thread" + std::to_string(t);
+        for (size_t i = 0; i < 2000; ++i) {
+          SubscriptionPointer<SimpleSubscribable> copy(sptr);
+          auto other = make_subscription(*sptr, id);
+          copy.reset();
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+
+    REQUIRE(sptr.get() == &s);
+#if defined(DEBUG) || defined(KRIMS_SUBSCRIPTION_COUNTING)
+    REQUIRE(s.n_subscriptions() == 1);
+#endif
+#ifdef DEBUG
+    REQUIRE(s.subscribers()[0] == "main");
+#endif
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+
+#if defined(DEBUG) || defined(KRIMS_SUBSCRIPTION_COUNTING)
+  SECTION("Moving a Subscribable with subscriptions is detected") {
+    // Also checked in RELEASE mode if subscriptions are counted
+    SimpleSubscribable s{};
+    auto sptr = make_subscription(s, "Test");
+    RCPWrapper<SimpleSubscribable> wrapper(sptr);
+    REQUIRE(s.n_subscriptions() == 2);
+    REQUIRE_THROWS_AS(SimpleSubscribable(std::move(s)), Subscribable::ExcStillUsed);
+
+    sptr.reset();
+    wrapper = RCPWrapper<SimpleSubscribable>();
+    REQUIRE(s.n_subscriptions() == 0);
+    SimpleSubscribable moved(std::move(s));
+  }
+
+  //
+  // ---------------------------------------------------------------
+  //
+#endif
+
   SECTION("Basic checks about Subscribables") {
     // create a Subscribable
     SimpleSubscribable s{};